@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include <map>
+#include <stdexcept>
 #include <typeinfo>
 #include <vector>
 #include "BindFactoryRegistrator.h"
@@ -39,7 +40,7 @@ public:
         size_t hash = typeid(T).hash_code();
 
         if (d_registrators[hash] != nullptr)
-            throw std::exception("Attempt to bind already binded object");
+            throw std::logic_error("Attempt to bind already binded object");
 
         auto registrator = new BindFactoryTypeRegistrator<T>(*this);
         d_registrators[hash] = registrator;
@@ -10,6 +10,9 @@ class BindFactoryTypeRegistrator;
 class BindFactoryRegistrator
 {
 public:
+    // Registrators are deleted through this base by BindFactory
+    virtual ~BindFactoryRegistrator() = default;
+
     template<typename T>
     BindFactoryTypeRegistrator<T>* implementation();
 };
@@ -0,0 +1,160 @@
+﻿#include "stdafx.h"
+#include "xrBenchmark.h"
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <thread>
+#include "xrTaskDispatcher/xrParallel.h"
+
+std::atomic<uint64_t> g_benchmark_allocations { 0 };
+
+void* operator new(size_t size)
+{
+    g_benchmark_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto memory = malloc(size ? size : 1))
+        return memory;
+    throw std::bad_alloc();
+}
+
+// Replaced too, the library may free nothrow allocations with the plain delete
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    g_benchmark_allocations.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    free(memory);
+}
+
+void xrBenchmark::add(const std::string& name, uint64_t iterations, double seconds, uint64_t items, uint64_t allocations)
+{
+    Result result;
+    result.name = name;
+    result.iterations = iterations;
+    result.ns_per_iteration = seconds * 1e9 / iterations;
+    result.items_per_second = seconds > 0 ? items * iterations / seconds : 0;
+    result.allocations_per_iteration = static_cast<double>(allocations) / iterations;
+    d_results.push_back(result);
+
+    fprintf(stderr, "%-56s %14.1f ns %16.0f items/s %10.2f allocs\n", name.c_str(),
+        result.ns_per_iteration, result.items_per_second, result.allocations_per_iteration);
+}
+
+std::string xrBenchmark::json() const
+{
+    char buffer[512];
+    std::string json;
+
+    time_t now = time(nullptr);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+
+#if defined(NDEBUG)
+    const char* build = "release";
+#else
+    const char* build = "debug";
+#endif
+
+    snprintf(buffer, sizeof(buffer),
+        "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"build\": \"%s\",\n    \"hardware_threads\": %u,\n"
+        "    \"async_workers\": %zu,\n    \"task_profiling\": %d,\n    \"min_time\": %.3f,\n    \"repetitions\": %zu\n  },\n"
+        "  \"benchmarks\": [",
+        date, build, std::thread::hardware_concurrency(), xrParallel::concurrency(), XR_TASK_PROFILING,
+        d_options.min_time, d_options.repetitions);
+    json += buffer;
+
+    for (size_t index = 0; index < d_results.size(); index++)
+    {
+        auto& result = d_results[index];
+        snprintf(buffer, sizeof(buffer),
+            "%s\n    {\"name\": \"%s\", \"iterations\": %llu, \"real_time\": %.3f, \"time_unit\": \"ns\", "
+            "\"items_per_second\": %.1f, \"allocations_per_iteration\": %.3f}",
+            index ? "," : "", result.name.c_str(), static_cast<unsigned long long>(result.iterations),
+            result.ns_per_iteration, result.items_per_second, result.allocations_per_iteration);
+        json += buffer;
+    }
+
+    json += "\n  ]\n}\n";
+    return json;
+}
+
+static bool option(const char* argument, const char* name, const char*& value)
+{
+    size_t length = strlen(name);
+    if (strncmp(argument, name, length) != 0 || argument[length] != '=')
+        return false;
+
+    value = argument + length + 1;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    xrBenchmarkOptions options;
+    const char* output = nullptr;
+
+    for (int index = 1; index < argc; index++)
+    {
+        const char* value = nullptr;
+        if (option(argv[index], "--filter", value))
+            options.filter = value;
+        else if (option(argv[index], "--min-time", value))
+            options.min_time = atof(value);
+        else if (option(argv[index], "--repetitions", value))
+            options.repetitions = static_cast<size_t>(atoi(value));
+        else if (option(argv[index], "--threads", value))
+            options.threads = static_cast<size_t>(atoi(value));
+        else if (option(argv[index], "--out", value))
+            output = value;
+        else
+        {
+            fprintf(stderr, "usage: %s [--filter=text] [--min-time=seconds] [--repetitions=n] [--threads=n] [--out=file.json]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    xrTaskPoolConfig config;
+    config.threads = options.threads;
+    xrAsyncTaskDispatcher::setDefaultConfig(config);
+    xrFactory::bind<xrAsyncTaskDispatcher>()->asSingleton();
+
+    // Receives then() callbacks and cross-thread posts made to the main thread
+    xrTaskDispatcher main_dispatcher;
+
+    xrBenchmark bench(options);
+    benchmarkDelegates(bench);
+    benchmarkEvents(bench);
+    benchmarkTasks(bench);
+    benchmarkFactory(bench);
+
+    auto json = bench.json();
+    xrFactory::unbind<xrAsyncTaskDispatcher>();
+
+    if (!output)
+    {
+        fputs(json.c_str(), stdout);
+        return 0;
+    }
+
+    auto file = fopen(output, "wb");
+    if (!file)
+    {
+        fprintf(stderr, "can't write %s\n", output);
+        return 1;
+    }
+
+    bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+    return fclose(file) == 0 && written ? 0 : 1;
+}
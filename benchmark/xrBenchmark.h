@@ -0,0 +1,115 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Heap allocations made by the process so far, counted by the benchmark's operator new
+extern std::atomic<uint64_t> g_benchmark_allocations;
+
+// Keeps the optimizer from dropping a computed value or the stores behind a pointer
+template<typename T>
+inline void keep(const T& value)
+{
+#if defined(__GNUC__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+struct xrBenchmarkOptions
+{
+    double min_time = 0.2;          // seconds a measured run must last
+    size_t repetitions = 3;         // measured runs per benchmark, the median is reported
+    size_t threads = 0;             // xrAsyncTaskDispatcher workers, 0 for one per processor
+    std::string filter;             // only benchmarks whose name contains it
+};
+
+/**
+ * \brief Runs benchmarks and collects their results as JSON. A benchmark is a callable
+ * taking an iteration count; the runner grows the count until one run lasts min_time,
+ * then repeats the run and reports the median time per iteration.
+ */
+class xrBenchmark
+{
+public:
+    explicit xrBenchmark(const xrBenchmarkOptions& options) : d_options(options) {}
+
+    const xrBenchmarkOptions& options() const
+    {
+        return d_options;
+    }
+
+    bool selected(const std::string& name) const
+    {
+        return d_options.filter.empty() || name.find(d_options.filter) != std::string::npos;
+    }
+
+    // items is the work done by one iteration, e.g. subscribers called per emit
+    template<typename Fx>
+    void run(const std::string& name, Fx fn, uint64_t items = 1)
+    {
+        if (!selected(name))
+            return;
+
+        uint64_t iterations = 1;
+        for (;;)
+        {
+            double seconds = measure(fn, iterations);
+            if (seconds >= d_options.min_time || iterations >= max_iterations)
+                break;
+
+            // Aim past min_time right away, but never more than 10x per step
+            double scale = seconds > 0 ? d_options.min_time * 1.4 / seconds : 10.0;
+            iterations = static_cast<uint64_t>(iterations * std::min(std::max(scale, 1.5), 10.0));
+        }
+
+        std::vector<double> times;
+        uint64_t allocations = 0;
+        for (size_t repetition = 0; repetition < std::max<size_t>(d_options.repetitions, 1); repetition++)
+        {
+            auto before = g_benchmark_allocations.load(std::memory_order_relaxed);
+            times.push_back(measure(fn, iterations));
+            allocations = g_benchmark_allocations.load(std::memory_order_relaxed) - before;
+        }
+
+        std::sort(times.begin(), times.end());
+        add(name, iterations, times[times.size() / 2], items, allocations);
+    }
+
+    std::string json() const;
+
+private:
+    static constexpr uint64_t max_iterations = 1000000000;
+
+    struct Result
+    {
+        std::string name;
+        uint64_t iterations;
+        double ns_per_iteration;
+        double items_per_second;
+        double allocations_per_iteration;
+    };
+
+    template<typename Fx>
+    static double measure(Fx& fn, uint64_t iterations)
+    {
+        auto begin = std::chrono::steady_clock::now();
+        fn(iterations);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+
+    void add(const std::string& name, uint64_t iterations, double seconds, uint64_t items, uint64_t allocations);
+
+    xrBenchmarkOptions d_options;
+    std::vector<Result> d_results;
+};
+
+void benchmarkDelegates(xrBenchmark& bench);
+void benchmarkEvents(xrBenchmark& bench);
+void benchmarkTasks(xrBenchmark& bench);
+void benchmarkFactory(xrBenchmark& bench);
@@ -0,0 +1,152 @@
+﻿#include "stdafx.h"
+#include "xrBenchmark.h"
+#include "xrDelegate/xrDelegate.h"
+
+// xrDelegate against the std::bind + std::function path it replaced
+
+namespace
+{
+    struct Counter
+    {
+        int add(int value)
+        {
+            d_sum += value;
+            return d_sum;
+        }
+
+        int d_sum = 0;
+    };
+
+    int twice(int value)
+    {
+        return value * 2;
+    }
+
+    // Does not fit the inline buffer of either delegate implementation
+    struct Large
+    {
+        char d_data[64] = {};
+    };
+
+    using Delegate = xrDelegate<int(int)>;
+    using Function = std::function<int(int)>;
+}
+
+void benchmarkDelegates(xrBenchmark& bench)
+{
+    using std::placeholders::_1;
+    Counter counter;
+    Large large;
+
+    bench.run("delegate/bind/free_function", [](uint64_t iterations)
+    {
+        for (uint64_t index = 0; index < iterations; index++)
+        {
+            Delegate delegate(&twice);
+            keep(delegate);
+        }
+    });
+
+    bench.run("delegate/bind/member", [&counter](uint64_t iterations)
+    {
+        for (uint64_t index = 0; index < iterations; index++)
+        {
+            Delegate delegate(&counter, &Counter::add);
+            keep(delegate);
+        }
+    });
+
+    bench.run("delegate/bind/small_lambda", [&counter](uint64_t iterations)
+    {
+        for (uint64_t index = 0; index < iterations; index++)
+        {
+            Delegate delegate([&counter](int value) { return counter.add(value); });
+            keep(delegate);
+        }
+    });
+
+    bench.run("delegate/bind/large_lambda", [&large](uint64_t iterations)
+    {
+        for (uint64_t index = 0; index < iterations; index++)
+        {
+            Delegate delegate([large](int value) { return value + large.d_data[0]; });
+            keep(delegate);
+        }
+    });
+
+    bench.run("std_function/bind/member", [&counter](uint64_t iterations)
+    {
+        for (uint64_t index = 0; index < iterations; index++)
+        {
+            Function function(std::bind(&Counter::add, &counter, _1));
+            keep(function);
+        }
+    });
+
+    bench.run("std_function/bind/small_lambda", [&counter](uint64_t iterations)
+    {
+        for (uint64_t index = 0; index < iterations; index++)
+        {
+            Function function([&counter](int value) { return counter.add(value); });
+            keep(function);
+        }
+    });
+
+    bench.run("std_function/bind/large_lambda", [&large](uint64_t iterations)
+    {
+        for (uint64_t index = 0; index < iterations; index++)
+        {
+            Function function([large](int value) { return value + large.d_data[0]; });
+            keep(function);
+        }
+    });
+
+    Delegate member(&counter, &Counter::add);
+    Function bound(std::bind(&Counter::add, &counter, _1));
+
+    bench.run("delegate/copy/member", [&member](uint64_t iterations)
+    {
+        for (uint64_t index = 0; index < iterations; index++)
+        {
+            Delegate copy(member);
+            keep(copy);
+        }
+    });
+
+    bench.run("std_function/copy/member", [&bound](uint64_t iterations)
+    {
+        for (uint64_t index = 0; index < iterations; index++)
+        {
+            Function copy(bound);
+            keep(copy);
+        }
+    });
+
+    bench.run("delegate/invoke/member", [&member](uint64_t iterations)
+    {
+        keep(&member);
+        int result = 0;
+        for (uint64_t index = 0; index < iterations; index++)
+            result += member(static_cast<int>(index));
+        keep(result);
+    });
+
+    bench.run("std_function/invoke/member", [&bound](uint64_t iterations)
+    {
+        keep(&bound);
+        int result = 0;
+        for (uint64_t index = 0; index < iterations; index++)
+            result += bound(static_cast<int>(index));
+        keep(result);
+    });
+
+    Delegate function(&twice);
+    bench.run("delegate/invoke/free_function", [&function](uint64_t iterations)
+    {
+        keep(&function);
+        int result = 0;
+        for (uint64_t index = 0; index < iterations; index++)
+            result += function(static_cast<int>(index));
+        keep(result);
+    });
+}
@@ -0,0 +1,138 @@
+﻿#include "stdafx.h"
+#include "xrBenchmark.h"
+#include <string>
+#include <thread>
+#include "xrConcurrentEvent.h"
+#include "xrEvent.h"
+#include "xrEmitter/xrSharedEmitter.h"
+
+namespace
+{
+    constexpr size_t fan_out[] = { 1, 16, 256 };
+    constexpr size_t emit_subscribers[] = { 0, 1, 16, 1000 };
+    constexpr size_t producers[] = { 1, 2, 4, 8 };
+
+    // Keys subscribed next to the measured one, so lookups search a populated table
+    constexpr size_t other_keys = 64;
+
+    struct Handler
+    {
+        void hit(int value)
+        {
+            d_sum += value;
+        }
+
+        int64_t d_sum = 0;
+    };
+
+    std::string name(const char* prefix, const char* parameter, size_t value)
+    {
+        return std::string(prefix) + "/" + parameter + ":" + std::to_string(value);
+    }
+
+    template<typename Emitter, typename Key>
+    void emitBenchmark(xrBenchmark& bench, const char* prefix, const std::vector<Key>& keys, const Key& key)
+    {
+        for (auto count : emit_subscribers)
+        {
+            Emitter emitter;
+            std::vector<Handler> handlers(count + 1);
+
+            for (auto& other : keys)
+                emitter.subscribe(other, &Handler::hit, &handlers[count]);
+            for (size_t index = 0; index < count; index++)
+                emitter.subscribe(key, &Handler::hit, &handlers[index]);
+
+            bench.run(name(prefix, "subscribers", count), [&emitter, &key](uint64_t iterations)
+            {
+                for (uint64_t index = 0; index < iterations; index++)
+                    emitter.emit(key, 1);
+            }, std::max<size_t>(count, 1));
+        }
+    }
+}
+
+void benchmarkEvents(xrBenchmark& bench)
+{
+    for (auto count : fan_out)
+    {
+        std::vector<Handler> handlers(count);
+
+        xrEvent<int> event;
+        for (auto& handler : handlers)
+            event.subscribe(&handler, &Handler::hit);
+
+        bench.run(name("event/invoke", "subscribers", count), [&event](uint64_t iterations)
+        {
+            for (uint64_t index = 0; index < iterations; index++)
+                event(1);
+        }, count);
+
+        xrConcurrentEvent<int> concurrent;
+        for (auto& handler : handlers)
+            concurrent.subscribe(&handler, &Handler::hit);
+
+        bench.run(name("concurrent_event/invoke", "subscribers", count), [&concurrent](uint64_t iterations)
+        {
+            for (uint64_t index = 0; index < iterations; index++)
+                concurrent(1);
+        }, count);
+    }
+
+    // Keys are not copied by the emitter, the strings outlive it
+    std::vector<std::string> names;
+    for (size_t index = 0; index < other_keys; index++)
+        names.push_back("benchmark_event_" + std::to_string(index));
+
+    std::vector<const char*> string_keys;
+    std::vector<xrEventId> id_keys;
+    for (auto& other : names)
+    {
+        string_keys.push_back(other.c_str());
+        id_keys.push_back(xrEventId::intern(other.c_str()));
+    }
+
+    emitBenchmark<xrEmitter>(bench, "emitter/emit/string_key", string_keys, static_cast<const char*>("benchmark_hit"));
+    emitBenchmark<xrEventEmitter>(bench, "emitter/emit/event_id", id_keys, XR_EVENT_ID("benchmark_hit"));
+
+    {
+        xrSharedEmitter emitter;
+        Handler handler;
+        emitter.subscribe("benchmark_hit", &Handler::hit, &handler);
+
+        bench.run("shared_emitter/emit_dispatch/same_thread", [&emitter](uint64_t iterations)
+        {
+            for (uint64_t index = 0; index < iterations; index++)
+            {
+                emitter.emit("benchmark_hit", 1);
+                emitter.dispatch();
+            }
+        });
+
+        // Producers emit from their own threads while the owner dispatches
+        for (auto count : producers)
+        {
+            bench.run(name("shared_emitter/emit_dispatch", "producers", count), [&emitter, &handler, count](uint64_t iterations)
+            {
+                uint64_t per_producer = (iterations + count - 1) / count;
+                int64_t expected = handler.d_sum + static_cast<int64_t>(per_producer * count);
+
+                std::vector<std::thread> threads;
+                for (size_t producer = 0; producer < count; producer++)
+                {
+                    threads.emplace_back([&emitter, per_producer]()
+                    {
+                        for (uint64_t index = 0; index < per_producer; index++)
+                            emitter.emit("benchmark_hit", 1);
+                    });
+                }
+
+                while (handler.d_sum != expected)
+                    emitter.dispatch();
+
+                for (auto& thread : threads)
+                    thread.join();
+            });
+        }
+    }
+}
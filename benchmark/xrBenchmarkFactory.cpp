@@ -0,0 +1,77 @@
+﻿#include "stdafx.h"
+#include "xrBenchmark.h"
+#include "BindFactory/BindFactory.h"
+
+namespace
+{
+    class IService
+    {
+    public:
+        virtual ~IService() = default;
+        virtual int value() const = 0;
+    };
+
+    class Service : public IService
+    {
+    public:
+        int value() const override
+        {
+            return 1;
+        }
+    };
+
+    class ITransient
+    {
+    public:
+        virtual ~ITransient() = default;
+    };
+
+    class Transient : public ITransient {};
+
+    class IUnbound
+    {
+    public:
+        virtual ~IUnbound() = default;
+    };
+
+    // Other bindings, so lookups search a populated registry
+    template<size_t index>
+    struct Filler {};
+
+    template<size_t ... index>
+    void bindFillers(BindFactory& factory, std::index_sequence<index...>)
+    {
+        (factory.bind<Filler<index>>()->asSingleton(), ...);
+    }
+}
+
+void benchmarkFactory(xrBenchmark& bench)
+{
+    BindFactory factory;
+    bindFillers(factory, std::make_index_sequence<64>{});
+    factory.bind<IService>()->asSingleton<Service>();
+    factory.bind<ITransient>()->asTransient<Transient>();
+
+    bench.run("factory/get/singleton", [&factory](uint64_t iterations)
+    {
+        for (uint64_t index = 0; index < iterations; index++)
+            keep(factory.get<IService>());
+    });
+
+    bench.run("factory/get/transient", [&factory](uint64_t iterations)
+    {
+        for (uint64_t index = 0; index < iterations; index++)
+        {
+            // Escapes, otherwise the new and delete pair may be elided
+            auto instance = factory.get<ITransient>();
+            keep(instance);
+            delete instance;
+        }
+    });
+
+    bench.run("factory/get/unbound", [&factory](uint64_t iterations)
+    {
+        for (uint64_t index = 0; index < iterations; index++)
+            keep(factory.get<IUnbound>());
+    });
+}
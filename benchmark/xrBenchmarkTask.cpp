@@ -0,0 +1,226 @@
+﻿#include "stdafx.h"
+#include "xrBenchmark.h"
+#include <cmath>
+#include <random>
+#include <string>
+#include <thread>
+#include "xrTaskDispatcher/xrParallel.h"
+
+namespace
+{
+    constexpr size_t producers[] = { 1, 2, 4, 8, 16, 64 };
+    constexpr size_t loop_sizes[] = { 1000, 100000, 10000000 };
+    constexpr size_t sort_sizes[] = { 100000, 1000000 };
+    constexpr size_t batch = 256;
+
+    int work()
+    {
+        return 1;
+    }
+
+    void transform(float* data, size_t begin, size_t end)
+    {
+        for (size_t index = begin; index < end; index++)
+            data[index] = std::sqrt(data[index] + 1.0f);
+    }
+
+    double sum(const float* data, size_t begin, size_t end)
+    {
+        double result = 0;
+        for (size_t index = begin; index < end; index++)
+            result += data[index];
+        return result;
+    }
+
+    std::string name(const char* prefix, const char* parameter, size_t value)
+    {
+        return std::string(prefix) + "/" + parameter + ":" + std::to_string(value);
+    }
+
+    // Submit and wait on the thread's own dispatcher, and posts to it from other threads
+    void mainThreadDispatcher(xrBenchmark& bench)
+    {
+        auto dispatcher = xrTaskDispatcher::getCurrentThreadDispatcher();
+
+        bench.run("task_dispatcher/add_dispatch", [dispatcher](uint64_t iterations)
+        {
+            for (uint64_t index = 0; index < iterations; index++)
+            {
+                auto task = dispatcher->addTask(&work);
+                dispatcher->dispatch();
+                keep(task->get());
+            }
+        });
+
+        bench.run(name("task_dispatcher/detached_dispatch", "batch", batch), [dispatcher](uint64_t iterations)
+        {
+            int executed = 0;
+            for (uint64_t index = 0; index < iterations; index++)
+            {
+                for (size_t task = 0; task < batch; task++)
+                    dispatcher->addDetachedTask([&executed]() { executed++; });
+                dispatcher->dispatch();
+            }
+            keep(executed);
+        }, batch);
+
+        for (auto count : producers)
+        {
+            bench.run(name("task_dispatcher/post", "producers", count), [dispatcher, count](uint64_t iterations)
+            {
+                uint64_t per_producer = (iterations + count - 1) / count;
+                uint64_t expected = per_producer * count;
+                uint64_t executed = 0;
+
+                std::vector<std::thread> threads;
+                for (size_t producer = 0; producer < count; producer++)
+                {
+                    threads.emplace_back([dispatcher, per_producer, &executed]()
+                    {
+                        for (uint64_t index = 0; index < per_producer; index++)
+                            dispatcher->addDetachedTask([&executed]() { executed++; });
+                    });
+                }
+
+                while (executed != expected)
+                    dispatcher->dispatch();
+
+                for (auto& thread : threads)
+                    thread.join();
+            });
+        }
+    }
+
+    void asyncDispatcher(xrBenchmark& bench)
+    {
+        bench.run("async/add_wait", [](uint64_t iterations)
+        {
+            for (uint64_t index = 0; index < iterations; index++)
+            {
+                auto task = xrAsyncTaskDispatcher::addTask(&work);
+                task->wait();
+                keep(task->get());
+            }
+        });
+
+        bench.run(name("async/queue_wait", "batch", batch), [](uint64_t iterations)
+        {
+            AsyncTaskSharedQueue queue;
+            for (uint64_t index = 0; index < iterations; index++)
+            {
+                for (size_t task = 0; task < batch; task++)
+                    xrAsyncTaskDispatcher::addTaskToQueue(queue, &work);
+                xrAsyncTaskDispatcher::waitQueue(queue);
+            }
+        }, batch);
+
+        bench.run(name("async/detached", "batch", batch), [](uint64_t iterations)
+        {
+            std::atomic<uint64_t> executed { 0 };
+            for (uint64_t index = 0; index < iterations; index++)
+            {
+                for (size_t task = 0; task < batch; task++)
+                    xrAsyncTaskDispatcher::addDetachedTask([&executed]() { executed.fetch_add(1, std::memory_order_release); });
+
+                // Acquire pairs with the workers' release, the tasks are done with the counter
+                // before it goes out of scope
+                while (executed.load(std::memory_order_acquire) != (index + 1) * batch)
+                    std::this_thread::yield();
+            }
+        }, batch);
+    }
+
+    // parallel_for, parallel_reduce and parallel_sort against a serial loop and one task per chunk
+    void parallelHelpers(xrBenchmark& bench)
+    {
+        for (auto size : loop_sizes)
+        {
+            std::vector<float> data(size, 1.0f);
+            auto values = data.data();
+
+            bench.run(name("parallel/for/serial", "n", size), [values, size](uint64_t iterations)
+            {
+                for (uint64_t index = 0; index < iterations; index++)
+                    transform(values, 0, size);
+                keep(values[0]);
+            }, size);
+
+            bench.run(name("parallel/for/parallel_for", "n", size), [values, size](uint64_t iterations)
+            {
+                for (uint64_t index = 0; index < iterations; index++)
+                    parallel_for(size_t(0), size, [values](size_t begin, size_t end) { transform(values, begin, end); });
+                keep(values[0]);
+            }, size);
+
+            // The pattern the helpers replace: one shared task per chunk, then waitQueue()
+            bench.run(name("parallel/for/manual_chunks", "n", size), [values, size](uint64_t iterations)
+            {
+                size_t chunks = xrParallel::concurrency() * 4;
+                size_t chunk = (size + chunks - 1) / chunks;
+
+                AsyncTaskSharedQueue queue;
+                for (uint64_t index = 0; index < iterations; index++)
+                {
+                    for (size_t begin = 0; begin < size; begin += chunk)
+                        xrAsyncTaskDispatcher::addTaskToQueue(queue, &transform, values, begin, std::min(begin + chunk, size));
+                    xrAsyncTaskDispatcher::waitQueue(queue);
+                }
+                keep(values[0]);
+            }, size);
+
+            bench.run(name("parallel/reduce/serial", "n", size), [values, size](uint64_t iterations)
+            {
+                for (uint64_t index = 0; index < iterations; index++)
+                    keep(sum(values, 0, size));
+            }, size);
+
+            bench.run(name("parallel/reduce/parallel_reduce", "n", size), [values, size](uint64_t iterations)
+            {
+                for (uint64_t index = 0; index < iterations; index++)
+                {
+                    keep(parallel_reduce(size_t(0), size, 0.0,
+                        [values](size_t begin, size_t end) { return sum(values, begin, end); },
+                        [](double a, double b) { return a + b; }));
+                }
+            }, size);
+        }
+
+        // Each iteration sorts a fresh copy of the same shuffled input, the copy is timed too
+        for (auto size : sort_sizes)
+        {
+            std::vector<int> source(size);
+            std::mt19937 random(12345);
+            for (auto& value : source)
+                value = static_cast<int>(random());
+
+            std::vector<int> data;
+
+            bench.run(name("parallel/sort/std_sort", "n", size), [&source, &data](uint64_t iterations)
+            {
+                for (uint64_t index = 0; index < iterations; index++)
+                {
+                    data = source;
+                    std::sort(data.begin(), data.end());
+                }
+                keep(data[0]);
+            }, size);
+
+            bench.run(name("parallel/sort/parallel_sort", "n", size), [&source, &data](uint64_t iterations)
+            {
+                for (uint64_t index = 0; index < iterations; index++)
+                {
+                    data = source;
+                    parallel_sort(data.begin(), data.end());
+                }
+                keep(data[0]);
+            }, size);
+        }
+    }
+}
+
+void benchmarkTasks(xrBenchmark& bench)
+{
+    mainThreadDispatcher(bench);
+    asyncDispatcher(bench);
+    parallelHelpers(bench);
+}
@@ -0,0 +1,9 @@
+﻿#include "stdafx.h"
+#include "xrFactory.h"
+
+// Defined by xrCore inside the engine. Constructed ahead of the xrInject statics of other
+// translation units, they register with the factory during static initialization.
+#if defined(__GNUC__)
+__attribute__((init_priority(101)))
+#endif
+XRCORE_API BindFactory xrFactory::d_factory;
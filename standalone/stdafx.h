@@ -0,0 +1,27 @@
+#pragma once
+// The part of the xrCore precompiled header the shared sources rely on
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <tuple>
+
+using u8 = std::uint8_t;
+using u32 = std::uint32_t;
+
+#define XRCORE_API
+#define IC inline
+
+// Checked in every build type, as in xrCore
+#define R_ASSERT(expr) \
+    do \
+    { \
+        if (!(expr)) \
+        { \
+            fprintf(stderr, "%s(%d): assertion failed: %s\n", __FILE__, __LINE__, #expr); \
+            abort(); \
+        } \
+    } while (false)
@@ -0,0 +1,24 @@
+﻿#include "stdafx.h"
+#include "xrEmitter/xrEventId.h"
+#include <cstring>
+
+// Two names interned under the same hash keep apart ids, and find() resolves each to its own
+static void collidingNamesGetOwnIds()
+{
+    const uint64_t hash = xrEventHash("collision_first");
+    auto first = xrEventId::intern(hash, "collision_first");
+    auto second = xrEventId::intern(hash, "collision_second");
+
+    R_ASSERT(first.valid() && second.valid() && first != second);
+    R_ASSERT(xrEventId::intern(hash, "collision_second") == second);
+    R_ASSERT(strcmp(xrEventId::name(second), "collision_second") == 0);
+
+    R_ASSERT(xrEventId::find("collision_first") == first);
+    R_ASSERT(!xrEventId::find("collision_missing").valid());
+}
+
+int main()
+{
+    collidingNamesGetOwnIds();
+    return 0;
+}
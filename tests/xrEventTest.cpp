@@ -0,0 +1,89 @@
+﻿#include "stdafx.h"
+#include "xrConcurrentEvent.h"
+#include "xrEvent.h"
+
+static int g_calls = 0;
+
+static void handler(int value)
+{
+    g_calls += value;
+}
+
+// Unsubscribing removes every subscription of the handler, whether or not an invocation runs
+static void unsubscribeRemovesDuplicates()
+{
+    xrEvent<int> event;
+    event.subscribe(&handler);
+    event.subscribe(&handler);
+    event.unsubscribe(&handler);
+
+    g_calls = 0;
+    event(1);
+    R_ASSERT(g_calls == 0);
+
+    bool unsubscribed = false;
+    event.subscribe(&handler);
+    event.subscribe(&handler);
+    event.subscribe([&event, &unsubscribed](int)
+    {
+        if (!unsubscribed)
+        {
+            unsubscribed = true;
+            event.subscribe(&handler);
+            event.unsubscribe(&handler);
+        }
+    });
+
+    g_calls = 0;
+    event(1);
+    R_ASSERT(g_calls == 2);
+
+    g_calls = 0;
+    event(1);
+    R_ASSERT(g_calls == 0);
+}
+
+static void concurrentUnsubscribeRemovesDuplicates()
+{
+    xrConcurrentEvent<int> event;
+    event.subscribe(&handler);
+    event.subscribe(&handler);
+    event.subscribe(&handler);
+    event.unsubscribe(&handler);
+
+    g_calls = 0;
+    event(1);
+    R_ASSERT(g_calls == 0);
+}
+
+// Counts copies of an argument, moves are free
+struct Payload
+{
+    static int d_copies;
+
+    Payload() = default;
+    Payload(const Payload&) { ++d_copies; }
+    Payload(Payload&&) noexcept = default;
+};
+
+int Payload::d_copies = 0;
+
+// Only subscribers before the last one get copies of a value argument
+static void valueArgumentsMoveIntoLastSubscriber()
+{
+    xrEvent<Payload> event;
+    for (int index = 0; index < 3; index++)
+        event.subscribe([](Payload) {});
+
+    Payload::d_copies = 0;
+    event(Payload());
+    R_ASSERT(Payload::d_copies == 2);
+}
+
+int main()
+{
+    unsubscribeRemovesDuplicates();
+    concurrentUnsubscribeRemovesDuplicates();
+    valueArgumentsMoveIntoLastSubscriber();
+    return 0;
+}
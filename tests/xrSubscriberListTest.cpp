@@ -0,0 +1,51 @@
+﻿#include "stdafx.h"
+#include "xrEmitter/xrEmitter.h"
+
+// Counts live copies of a handler, a slot destroyed twice or never drives it off
+struct Tracker
+{
+    static int d_alive;
+
+    Tracker() { ++d_alive; }
+    Tracker(const Tracker&) { ++d_alive; }
+    Tracker(Tracker&&) noexcept { ++d_alive; }
+    ~Tracker() { --d_alive; }
+};
+
+int Tracker::d_alive = 0;
+
+// A slot released by handle outside an emit stays in the array, growing the array must
+// not bring it back to life
+static void releasedSlotSurvivesGrowth()
+{
+    int calls = 0;
+    {
+        xrEmitter emitter;
+        xrEmitterHandle handles[3];
+        for (auto& handle : handles)
+        {
+            Tracker tracker;
+            handle = emitter.subscribe("event", [tracker, &calls]() { ++calls; });
+        }
+
+        emitter.unsubscribe("event", handles[1]);
+        R_ASSERT(Tracker::d_alive == 2);
+
+        for (int index = 0; index < 20; index++)
+        {
+            Tracker tracker;
+            emitter.subscribe("event", [tracker, &calls]() { ++calls; });
+        }
+
+        R_ASSERT(Tracker::d_alive == 22);
+        emitter.emit("event");
+        R_ASSERT(calls == 22);
+    }
+    R_ASSERT(Tracker::d_alive == 0);
+}
+
+int main()
+{
+    releasedSlotSurvivesGrowth();
+    return 0;
+}
@@ -0,0 +1,84 @@
+﻿#include "stdafx.h"
+#include "xrTaskDispatcher/xrTaskDispatcher.h"
+
+#if defined(__cpp_impl_coroutine)
+static int answer()
+{
+    return 42;
+}
+
+template<typename Task>
+static xrCoroutine<int> await(std::shared_ptr<Task> task, TASK_STATE& state)
+{
+    try
+    {
+        co_return co_await task;
+    }
+    catch (const xrTaskCancelled& e)
+    {
+        state = e.state();
+        co_return -1;
+    }
+}
+
+// A task that is dropped before it runs has no result, awaiting it must not reach get()
+static void awaitDroppedTask()
+{
+    xrTaskDispatcher dispatcher;
+
+    // Already cancelled when awaited
+    {
+        auto task = dispatcher.addTask(&answer);
+        R_ASSERT(task->cancel());
+
+        TASK_STATE state = STATE_WAIT;
+        auto coroutine = await(task, state);
+        R_ASSERT(coroutine.get() == -1 && state == STATE_CANCELLED);
+    }
+
+    // Cancelled while the coroutine is suspended on it
+    {
+        auto task = dispatcher.addTask(&answer);
+
+        TASK_STATE state = STATE_WAIT;
+        auto coroutine = await(task, state);
+        R_ASSERT(!coroutine.ready());
+
+        R_ASSERT(task->cancel());
+        while (!coroutine.ready())
+            dispatcher.dispatch();
+        R_ASSERT(coroutine.get() == -1 && state == STATE_CANCELLED);
+    }
+
+    // Past its deadline when it reaches the front of the queue
+    {
+        auto task = dispatcher.addTask(&answer);
+        task->setDeadline(std::chrono::steady_clock::now() - std::chrono::seconds(1));
+
+        TASK_STATE state = STATE_WAIT;
+        auto coroutine = await(task, state);
+        while (!coroutine.ready())
+            dispatcher.dispatch();
+        R_ASSERT(coroutine.get() == -1 && state == STATE_EXPIRED);
+    }
+
+    // Executed tasks still hand their result over
+    {
+        auto task = dispatcher.addTask(&answer);
+
+        TASK_STATE state = STATE_WAIT;
+        auto coroutine = await(task, state);
+        while (!coroutine.ready())
+            dispatcher.dispatch();
+        R_ASSERT(coroutine.get() == 42 && state == STATE_WAIT);
+    }
+}
+#endif
+
+int main()
+{
+#if defined(__cpp_impl_coroutine)
+    awaitDroppedTask();
+#endif
+    return 0;
+}
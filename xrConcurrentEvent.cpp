@@ -0,0 +1,4 @@
+﻿#include "stdafx.h"
+#include "xrConcurrentEvent.h"
+
+XRCORE_API std::atomic<xrSnapshotReaders::Slot*> xrSnapshotReaders::d_slots { nullptr };
@@ -0,0 +1,272 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "xrDelegate/xrDelegate.h"
+#include "xrPlatform/xrLock.h"
+
+/**
+ * \brief Tracks threads reading RCU-style snapshots. A reader only writes a sequence number in its
+ * own slot, so reads scale with cores. A writer that replaced a snapshot notes the readers inside
+ * a read section at that moment; the snapshot may be freed once each of them has left.
+ */
+class XRCORE_API xrSnapshotReaders
+{
+public:
+    struct alignas(64) Slot
+    {
+        // Odd while the owning thread is inside a read section
+        std::atomic<uint64_t> d_sequence { 0 };
+        std::atomic<bool> d_used { false };
+        Slot* d_next = nullptr;
+        // Nested read sections of the owning thread, only the outermost one is published
+        size_t d_depth = 0;
+    };
+
+    using Readers = std::vector<std::pair<Slot*, uint64_t>>;
+
+    class ReadSection
+    {
+    public:
+        ReadSection() : d_slot(current())
+        {
+            if (d_slot.d_depth++ == 0)
+            {
+                d_slot.d_sequence.store(d_slot.d_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+                // Pairs with the fence in active(): either the writer sees this reader, or the
+                // reader sees the snapshot the writer published
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        ~ReadSection()
+        {
+            if (--d_slot.d_depth == 0)
+                d_slot.d_sequence.store(d_slot.d_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        ReadSection(const ReadSection& other) = delete;
+        ReadSection& operator=(const ReadSection& other) = delete;
+
+    private:
+        Slot& d_slot;
+    };
+
+    // Readers inside a read section, called by a writer right after it published a new snapshot
+    static Readers active()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        Readers readers;
+        for (auto slot = d_slots.load(std::memory_order_acquire); slot; slot = slot->d_next)
+        {
+            auto sequence = slot->d_sequence.load(std::memory_order_acquire);
+            if (sequence & 1)
+                readers.emplace_back(slot, sequence);
+        }
+        return readers;
+    }
+
+    // True once every reader of the list has left the read section it was in
+    static bool left(const Readers& readers)
+    {
+        for (auto& reader : readers)
+        {
+            if (reader.first->d_sequence.load(std::memory_order_acquire) == reader.second)
+                return false;
+        }
+        return true;
+    }
+
+private:
+    // A finished thread hands its slot over to the next new reader
+    struct Owner
+    {
+        Owner() : d_slot(acquire()) {}
+
+        ~Owner()
+        {
+            d_slot->d_used.store(false, std::memory_order_release);
+        }
+
+        Slot* d_slot;
+    };
+
+    static Slot& current()
+    {
+        thread_local Owner owner;
+        return *owner.d_slot;
+    }
+
+    static Slot* acquire()
+    {
+        for (auto slot = d_slots.load(std::memory_order_acquire); slot; slot = slot->d_next)
+        {
+            bool expected = false;
+            if (!slot->d_used.load(std::memory_order_relaxed) &&
+                slot->d_used.compare_exchange_strong(expected, true, std::memory_order_acquire))
+                return slot;
+        }
+
+        // Slots are never freed, writers walk the list without locking
+        auto slot = new Slot();
+        slot->d_used.store(true, std::memory_order_relaxed);
+        slot->d_next = d_slots.load(std::memory_order_relaxed);
+        while (!d_slots.compare_exchange_weak(slot->d_next, slot, std::memory_order_release, std::memory_order_relaxed)) {}
+        return slot;
+    }
+
+    static std::atomic<Slot*> d_slots;
+};
+
+/**
+ * \brief xrEvent that may be subscribed, unsubscribed and invoked from any thread. Invocation
+ * reads an immutable snapshot of the subscribers without locking; subscribe and unsubscribe
+ * copy it, publish the copy and free the old one once no reader can still be using it.
+ * A handler may still be called from an older snapshot after unsubscribe() returned,
+ * synchronize() waits for such calls to finish.
+ */
+template<typename ... Args>
+class xrConcurrentEvent
+{
+public:
+    xrConcurrentEvent() = default;
+    xrConcurrentEvent(const xrConcurrentEvent& other) = delete;
+    xrConcurrentEvent(xrConcurrentEvent&& other) = delete;
+    xrConcurrentEvent& operator=(const xrConcurrentEvent& other) = delete;
+    xrConcurrentEvent& operator=(xrConcurrentEvent&& other) = delete;
+    xrConcurrentEvent operator*() = delete;
+
+    // No invocation may be running
+    ~xrConcurrentEvent()
+    {
+        delete d_snapshot.load(std::memory_order_relaxed);
+        for (auto& retired : d_retired)
+            delete retired.first;
+    }
+
+    template<typename TFunction>
+    void subscribe(TFunction fx) const
+    {
+        add(BindDelegate(fx));
+    }
+
+    template<typename TClass, typename TFunction>
+    void subscribe(TClass tx, TFunction fx) const
+    {
+        add(BindDelegate(tx, fx));
+    }
+
+    template<typename TFunction>
+    void unsubscribe(TFunction fx) const
+    {
+        remove(BindDelegate(fx));
+    }
+
+    template<typename TClass, typename TFunction>
+    void unsubscribe(TClass tx, TFunction fx) const
+    {
+        remove(BindDelegate(tx, fx));
+    }
+
+    // Handlers may subscribe and unsubscribe, the change applies from the next invocation
+    void operator()(const Args& ... args) const
+    {
+        xrSnapshotReaders::ReadSection section;
+
+        if (auto snapshot = d_snapshot.load(std::memory_order_acquire))
+        {
+            for (auto& subscriber : *snapshot)
+                subscriber(args...);
+        }
+    }
+
+    /**
+     * \brief Waits until invocations that may have read a snapshot older than the current one
+     * are done. Must not be called from a handler.
+     */
+    void synchronize() const
+    {
+        auto readers = xrSnapshotReaders::active();
+        while (!xrSnapshotReaders::left(readers))
+            std::this_thread::yield();
+
+        std::lock_guard<xrLock> lock(d_write_lock);
+        reclaim();
+    }
+
+private:
+    using Delegate = xrDelegate<void(Args...)>;
+    using Snapshot = std::vector<Delegate>;
+
+    void add(Delegate delegate) const
+    {
+        modify([&delegate](Snapshot& subscribers)
+        {
+            subscribers.push_back(std::move(delegate));
+            return true;
+        });
+    }
+
+    void remove(const Delegate& delegate) const
+    {
+        modify([&delegate](Snapshot& subscribers)
+        {
+            // Every subscription of the delegate goes, as with xrEvent
+            auto result = std::remove(subscribers.begin(), subscribers.end(), delegate);
+            if (result == subscribers.end())
+                return false;
+
+            subscribers.erase(result, subscribers.end());
+            return true;
+        });
+    }
+
+    // Writers are serialized, each publishes an edited copy of the current snapshot
+    template<typename Fx>
+    void modify(Fx fx) const
+    {
+        std::lock_guard<xrLock> lock(d_write_lock);
+
+        auto current = d_snapshot.load(std::memory_order_relaxed);
+        auto next = current ? new Snapshot(*current) : new Snapshot();
+        if (!fx(*next))
+        {
+            delete next;
+            return;
+        }
+
+        d_snapshot.store(next, std::memory_order_release);
+        reclaim();
+
+        if (current)
+        {
+            auto readers = xrSnapshotReaders::active();
+            if (readers.empty())
+                delete current;
+            else
+                d_retired.emplace_back(current, std::move(readers));
+        }
+    }
+
+    void reclaim() const
+    {
+        d_retired.erase(std::remove_if(d_retired.begin(), d_retired.end(), [](const Retired& retired)
+        {
+            if (!xrSnapshotReaders::left(retired.second))
+                return false;
+
+            delete retired.first;
+            return true;
+        }), d_retired.end());
+    }
+
+    using Retired = std::pair<Snapshot*, xrSnapshotReaders::Readers>;
+
+    mutable std::atomic<Snapshot*> d_snapshot { nullptr };
+    mutable std::vector<Retired> d_retired;
+    mutable xrLock d_write_lock;
+};
@@ -1,18 +1,8 @@
 #pragma once
 #include <functional>
+#include <new>
 #include "xrDelegateArguments.h"
-
-template<int>
-struct delegate_argument
-{};
-
-namespace std
-{
-    template<int N>
-    struct is_placeholder<delegate_argument<N>>
-        : integral_constant<int, N + 1> // the one is important
-    {};
-}
+#include "xrDelegateStorage.h"
 
 template<typename Result>
 class xrAbstractDelegate
@@ -58,6 +48,9 @@ public:
 
     virtual Result invoke_args(xrDelegateArguments& args) const = 0;
 
+    // Move-constructs the concrete delegate into raw memory, used for by-value storage of erased delegates.
+    virtual xrAbstractDelegate* move_to(void* memory) noexcept = 0;
+
     template<typename ... Args>
     Result invoke(Args ... args) const;
 
@@ -84,6 +77,7 @@ public:
     using inherited = xrAbstractDelegate<Result>;
     using tuple_type = std::tuple<Args...>;
     using function_type = std::function<Result(Args...)>;
+    using storage_type = xrDelegateStorage<Result(Args...)>;
 
     xrDelegate() = default;
 
@@ -91,13 +85,13 @@ public:
 
     xrDelegate(const xrDelegate& other)
         : inherited(other),
-        d_function(other.d_function)
+        d_storage(other.d_storage)
     {
     }
 
     xrDelegate(xrDelegate&& other) noexcept
         : inherited(std::move(other)),
-        d_function(std::move(other.d_function))
+        d_storage(std::move(other.d_storage))
     {
     }
 
@@ -106,7 +100,7 @@ public:
         if (this == &other)
             return *this;
         inherited::operator =(other);
-        d_function = other.d_function;
+        d_storage = other.d_storage;
         return *this;
     }
 
@@ -115,11 +109,11 @@ public:
         if (this == &other)
             return *this;
         inherited::operator =(std::move(other));
-        d_function = std::move(other.d_function);
+        d_storage = std::move(other.d_storage);
         return *this;
     }
 
-    template<typename Fx>
+    template<typename Fx, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Fx>, xrDelegate>>>
     xrDelegate(Fx fx)
     {
         bind(fx);
@@ -136,27 +130,24 @@ public:
     template<typename TClass, typename TFunction>
     void bind(TClass fx, TFunction tx)
     {
-        using sequence = std::make_index_sequence<sizeof ... (Args)>;
-        auto functor = bind_impl(sequence{}, tx, fx); 
+        using Functor = xrDelegateMember<TClass, TFunction>;
         inherited::d_function_hash = typeid(TFunction).hash_code();
-        inherited::d_functor_hash = typeid(decltype(functor)).hash_code();
+        inherited::d_functor_hash = typeid(Functor).hash_code();
         inherited::d_handle = fx;
-        d_function = functor;
+        d_storage.assign(Functor{ fx, tx });
     }
 
     template<typename TFunction>
     void bind(TFunction fx)
     {
-        using sequence = std::make_index_sequence<sizeof ... (Args)>;
-        auto functor = bind_impl(sequence{}, fx);
         inherited::d_function_hash = typeid(TFunction).hash_code();
-        inherited::d_functor_hash = typeid(decltype(functor)).hash_code();
-        d_function = functor;
+        inherited::d_functor_hash = typeid(std::decay_t<TFunction>).hash_code();
+        d_storage.assign(std::move(fx));
     }
 
     void reset()
     {
-        d_function = nullptr;
+        d_storage.reset();
         inherited::d_handle = nullptr;
         inherited::d_functor_hash = 0;
         inherited::d_function_hash = 0;
@@ -174,28 +165,30 @@ public:
             else
                 return run(values, index_sequence{});
         }
-        else if constexpr (std::is_same_v<Result, void>)
-            d_function();
         else
-            return d_function();
+            return d_storage.invoke();
+    }
+
+    inherited* move_to(void* memory) noexcept override
+    {
+        return new (memory) xrDelegate(std::move(*this));
     }
 
     Result invoke(Args ... args) const
     {
-        if constexpr (std::is_same_v<Result, void>)
-            d_function(std::forward<Args>(args)...);
-        else
-            return d_function(std::forward<Args>(args)...);
+        return d_storage.invoke(std::forward<Args>(args)...);
     }
 
-    const function_type& get_function() const
+    function_type get_function() const
     {
-        return d_function;
+        if (empty())
+            return nullptr;
+        return function_type(*this);
     }
 
     bool empty() const
     {
-        return d_function == nullptr;
+        return d_storage.empty();
     }
 
     xrDelegate& operator=(std::nullptr_t) noexcept
@@ -206,10 +199,7 @@ public:
 
     Result operator()(Args ... args) const
     {
-        if constexpr (std::is_same_v<Result, void>)
-            invoke(std::forward<Args>(args)...);
-        else
-            return invoke(std::forward<Args>(args)...);
+        return d_storage.invoke(std::forward<Args>(args)...);
     }
 
     bool operator==(const xrDelegate<Result(Args...)>& delegate) const
@@ -233,16 +223,21 @@ private:
     template<std::size_t... index>
     Result run(tuple_type& tup, std::index_sequence<index...>) const
     {
-        return d_function(std::forward<Args>(std::get<index>(tup))...);
+        return d_storage.invoke(queued<Args>(std::get<index>(tup))...);
     }
 
-    template<typename ... Fx, size_t... Is>
-    static auto bind_impl(std::integer_sequence<size_t, Is...>, Fx&& ... fx)
+    // Queued arguments are shared by every subscriber, each call gets its own copy of a value.
+    // Move-only values are moved out, so only the first subscriber receives them.
+    template<typename T>
+    static decltype(auto) queued(std::remove_reference_t<T>& value)
     {
-        return std::bind(fx ..., delegate_argument<Is>{}...);
+        if constexpr (std::is_reference_v<T> || !std::is_copy_constructible_v<T>)
+            return static_cast<delegate_param_t<T>>(value);
+        else
+            return T(value);
     }
 
-    function_type d_function = nullptr;
+    storage_type d_storage;
 };
 
 template <typename Result>
@@ -250,7 +245,7 @@ template <typename ... Args>
 Result xrAbstractDelegate<Result>::invoke(Args... args) const
 {
     auto self = const_cast<xrAbstractDelegate<Result>*>(this);
-    return static_cast<xrDelegate<Result(Args...)>*>(self)->invoke(args...);
+    return static_cast<xrDelegate<Result(Args...)>*>(self)->invoke(std::forward<Args>(args)...);
 }
 
 #include "xrDelegateBinder.h"
\ No newline at end of file
@@ -7,7 +7,10 @@ class xrDelegateArguments
 {
 public:
     virtual ~xrDelegateArguments() = default;
-    
+
+    // Heap copy of the pack, for callers that have to keep it past the emitting call.
+    virtual xrDelegateArguments* clone() const = 0;
+
     template<typename ... Args>
     xrDelegateArgumentsTypes<Args...>& get()
     {
@@ -23,7 +26,12 @@ public:
     using tuple_type = std::tuple<Args...>;
 
     xrDelegateArgumentsTypes(Args&& ... args) : d_args(args...) {}
-    
+
+    xrDelegateArguments* clone() const override
+    {
+        return new xrDelegateArgumentsTypes(*this);
+    }
+
     tuple_type& values() { return d_args; }
 
     auto&& first() { return std::get<0>(d_args); }
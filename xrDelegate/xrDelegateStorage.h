@@ -0,0 +1,196 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Parameter type of the type-erased invoke thunk: references as they are, values as T&& so they
+// are forwarded into the bound callable without a copy and move-only arguments work.
+template<typename T>
+using delegate_param_t = std::conditional_t<std::is_reference_v<T>, T, T&&>;
+
+template<typename TClass, typename TFunction>
+struct xrDelegateMember
+{
+    TClass object;
+    TFunction function;
+
+    template<typename ... Args>
+    decltype(auto) operator()(Args&& ... args) const
+    {
+        return std::invoke(function, object, std::forward<Args>(args)...);
+    }
+};
+
+template<typename Signature>
+class xrDelegateStorage;
+
+/**
+ * \brief Type-erased callable with an inline buffer. Free functions, (object, member function)
+ * pairs and lambdas up to buffer_size bytes are stored without heap allocation.
+ */
+template<typename Result, typename ... Args>
+class xrDelegateStorage<Result(Args...)>
+{
+public:
+    static constexpr size_t buffer_size = 4 * sizeof(void*);
+
+    template<typename Fx>
+    static constexpr bool is_inline = sizeof(Fx) <= buffer_size
+        && alignof(Fx) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible_v<Fx>;
+
+    xrDelegateStorage() = default;
+
+    xrDelegateStorage(const xrDelegateStorage& other)
+    {
+        copy_from(other);
+    }
+
+    xrDelegateStorage(xrDelegateStorage&& other) noexcept
+    {
+        move_from(other);
+    }
+
+    xrDelegateStorage& operator=(const xrDelegateStorage& other)
+    {
+        if (this == &other)
+            return *this;
+        reset();
+        copy_from(other);
+        return *this;
+    }
+
+    xrDelegateStorage& operator=(xrDelegateStorage&& other) noexcept
+    {
+        if (this == &other)
+            return *this;
+        reset();
+        move_from(other);
+        return *this;
+    }
+
+    ~xrDelegateStorage()
+    {
+        reset();
+    }
+
+    template<typename Fx>
+    void assign(Fx&& fx)
+    {
+        using Functor = std::decay_t<Fx>;
+
+        reset();
+        if constexpr (is_inline<Functor>)
+            new (d_buffer) Functor(std::forward<Fx>(fx));
+        else
+            *reinterpret_cast<Functor**>(d_buffer) = new Functor(std::forward<Fx>(fx));
+
+        d_invoke = &invoke_impl<Functor>;
+        d_manage = &manage_impl<Functor>;
+    }
+
+    void reset()
+    {
+        if (d_manage)
+            d_manage(Operation::Destroy, d_buffer, nullptr);
+
+        d_invoke = nullptr;
+        d_manage = nullptr;
+    }
+
+    bool empty() const
+    {
+        return d_invoke == nullptr;
+    }
+
+    Result invoke(delegate_param_t<Args> ... args) const
+    {
+        return d_invoke(const_cast<unsigned char*>(d_buffer), std::forward<delegate_param_t<Args>>(args)...);
+    }
+
+private:
+    enum class Operation
+    {
+        Copy,
+        Move,
+        Destroy
+    };
+
+    using invoke_function = Result(*)(void*, delegate_param_t<Args>...);
+    using manage_function = void(*)(Operation, void*, void*);
+
+    template<typename Functor>
+    static Functor& access(void* buffer)
+    {
+        if constexpr (is_inline<Functor>)
+            return *std::launder(reinterpret_cast<Functor*>(buffer));
+        else
+            return **reinterpret_cast<Functor**>(buffer);
+    }
+
+    template<typename Functor>
+    static Result invoke_impl(void* buffer, delegate_param_t<Args> ... args)
+    {
+        if constexpr (std::is_same_v<Result, void>)
+            std::invoke(access<Functor>(buffer), std::forward<delegate_param_t<Args>>(args)...);
+        else
+            return std::invoke(access<Functor>(buffer), std::forward<delegate_param_t<Args>>(args)...);
+    }
+
+    template<typename Functor>
+    static void manage_impl(Operation operation, void* dst, void* src)
+    {
+        switch (operation)
+        {
+        case Operation::Copy:
+            if constexpr (is_inline<Functor>)
+                new (dst) Functor(access<Functor>(src));
+            else
+                *reinterpret_cast<Functor**>(dst) = new Functor(access<Functor>(src));
+            break;
+
+        case Operation::Move:
+            if constexpr (is_inline<Functor>)
+            {
+                new (dst) Functor(std::move(access<Functor>(src)));
+                access<Functor>(src).~Functor();
+            }
+            else
+                *reinterpret_cast<Functor**>(dst) = *reinterpret_cast<Functor**>(src);
+            break;
+
+        case Operation::Destroy:
+            if constexpr (is_inline<Functor>)
+                access<Functor>(dst).~Functor();
+            else
+                delete &access<Functor>(dst);
+            break;
+        }
+    }
+
+    void copy_from(const xrDelegateStorage& other)
+    {
+        if (other.d_manage)
+            other.d_manage(Operation::Copy, d_buffer, const_cast<unsigned char*>(other.d_buffer));
+
+        d_invoke = other.d_invoke;
+        d_manage = other.d_manage;
+    }
+
+    void move_from(xrDelegateStorage& other) noexcept
+    {
+        if (other.d_manage)
+            other.d_manage(Operation::Move, d_buffer, other.d_buffer);
+
+        d_invoke = other.d_invoke;
+        d_manage = other.d_manage;
+        other.d_invoke = nullptr;
+        other.d_manage = nullptr;
+    }
+
+    alignas(std::max_align_t) unsigned char d_buffer[buffer_size];
+    invoke_function d_invoke = nullptr;
+    manage_function d_manage = nullptr;
+};
@@ -1,8 +1,10 @@
 ﻿#pragma once
+#include <cstring>
 #include <map>
-#include <list>
 #include "../xrDelegate/xrDelegate.h"
 #include "../xrArrayHelpers.h"
+#include "xrEmitterKeyTable.h"
+#include "xrSubscriberList.h"
 
 template<typename Key>
 class xrEmitterCore
@@ -11,42 +13,58 @@ public:
     virtual ~xrEmitterCore() = default;
 
     template<typename T>
-    void subscribe(const Key& event, T function)
+    xrEmitterHandle subscribe(const Key& event, T function)
     {        
-        push_impl(event, BindDelegatePtr(function));
+        auto delegate = BindDelegate(function);
+        return push(event, delegate);
     }
 
     template<typename T, typename V>
-    void subscribe(const Key& event, T function, V ptr)
+    xrEmitterHandle subscribe(const Key& event, T function, V ptr)
     {
-        push_impl(event, BindDelegatePtr(function, ptr));
+        auto delegate = BindDelegate(ptr, function);
+        return push(event, delegate);
     }
 
     template<typename T>
     void unsubscribe(const Key& event, T function)
     {
-        pop_impl(event, BindDelegatePtr(function));
+        pop_impl(event, BindDelegate(function));
     }
 
     template<typename T, typename V>
     void unsubscribe(const Key& event, T function, V ptr)
     {
-        pop_impl(event, BindDelegatePtr(function, ptr));
+        pop_impl(event, BindDelegate(ptr, function));
+    }
+
+    void unsubscribe(const Key& event, xrEmitterHandle handle)
+    {
+        pop_impl(event, handle);
     }
 
     template<typename ... Args>
     void emit(const Key& event, Args ... args)
     {
-        if constexpr (sizeof ... (Args) > 0)
-            emit_impl(event, BindDelegateArgsPtr(std::forward<Args>(args)...));
-        else
-            emit_impl(event, nullptr);
+        xrDelegateArgumentsTypes<Args...> arguments(std::forward<Args>(args)...);
+        emit_impl(event, arguments);
     }
 
 protected:
-    virtual void emit_impl(const Key& event, xrDelegateArguments* args) = 0;
-    virtual void push_impl(const Key& event, xrAbstractDelegate<void>* handler) = 0;
-    virtual void pop_impl(const Key& event, xrAbstractDelegate<void>* handler) = 0;
+    // args lives on the emitter's stack, implementations that defer the event must clone it
+    virtual void emit_impl(const Key& event, xrDelegateArguments& args) = 0;
+    // handler is a temporary, implementations take it over with move_to
+    virtual xrEmitterHandle push_impl(const Key& event, xrAbstractDelegate<void>& handler) = 0;
+    virtual void pop_impl(const Key& event, const xrAbstractDelegate<void>& handler) = 0;
+    virtual void pop_impl(const Key& event, xrEmitterHandle handle) = 0;
+
+private:
+    template<typename TDelegate>
+    xrEmitterHandle push(const Key& event, TDelegate& delegate)
+    {
+        static_assert(sizeof(TDelegate) <= xrSubscriberList::slot_size, "delegate does not fit subscriber slot");
+        return push_impl(event, delegate);
+    }
 };
 
 template<typename Key, typename KeyComparator>
@@ -58,56 +76,37 @@ class xrEmitterType : public xrEmitterCore<Key>
     friend class xrSharedEmitterType<Key, KeyComparator>;
 
 public:    
-    virtual ~xrEmitterType()
-    {
-        auto map_it = d_map.begin();
-        auto map_ite = d_map.end();
-        while (map_it != map_ite)
-        {
-            auto sub_it = map_it->second.begin();
-            auto sub_ite = map_it->second.end();
-            while (sub_it != sub_ite)
-                delete (*sub_it++);
-            ++map_it;
-        }
-    }
+    virtual ~xrEmitterType() = default;
 
 protected:
-    using SubscribersList = std::list<xrAbstractDelegate<void>*>;
-    using SubscribersMap = std::map<Key, SubscribersList, KeyComparator>;
+    using SubscribersList = xrSubscriberList;
+    using SubscribersMap = xrEmitterKeyTable<Key, KeyComparator, SubscribersList>;
     SubscribersMap d_map;
 
-    virtual void emit_impl(const Key& event, xrDelegateArguments* args)
+    void emit_impl(const Key& event, xrDelegateArguments& args) override
     {
-        auto& d_subscribers = d_map[event];
-        auto it = d_subscribers.begin();
-        auto ite = d_subscribers.end();
-        while (it != ite)
-            (*it++)->invoke_args(*args);
+        auto d_subscribers = d_map.find(event);
+        if (d_subscribers)
+            d_subscribers->invoke(args);
+    }
 
-        delete args;
+    xrEmitterHandle push_impl(const Key& event, xrAbstractDelegate<void>& handler) override
+    {
+        return d_map.get(event).push(handler);
     }
 
-    virtual void push_impl(const Key& event, xrAbstractDelegate<void>* handler)
+    void pop_impl(const Key& event, const xrAbstractDelegate<void>& handler) override
     {
-        d_map[event].push_back(handler);        
+        auto d_subscribers = d_map.find(event);
+        if (d_subscribers)
+            d_subscribers->pop(handler);
     }
 
-    virtual void pop_impl(const Key& event, xrAbstractDelegate<void>* handler)
+    void pop_impl(const Key& event, xrEmitterHandle handle) override
     {
-        auto& d_subscribers = d_map[event];
-
-        auto result = std::find_if(d_subscribers.begin(), d_subscribers.end(), [handler](xrAbstractDelegate<void>* callback)
-        {
-            return *callback == *handler;
-        });
-
-        if (result != d_subscribers.end())
-        {
-            delete handler;
-            delete *result;
-            d_subscribers.erase(result);
-        }
+        auto d_subscribers = d_map.find(event);
+        if (d_subscribers)
+            d_subscribers->pop(handle);
     }
 };
 
@@ -122,4 +121,7 @@ struct CharCompare
 };
 #pragma warning(pop)
 
-using xrEmitter = xrEmitterType<const char*, CharCompare>;
\ No newline at end of file
+using xrEmitter = xrEmitterType<const char*, CharCompare>;
+
+// Emitter keyed by interned ids: subscribers are indexed by id, no string compares on emit.
+using xrEventEmitter = xrEmitterType<xrEventId>;
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+#include <deque>
+#include <map>
+#include "xrEventId.h"
+
+/**
+ * \brief Maps emitter keys to subscriber lists. find() never inserts, so emitting
+ * or unsubscribing an unknown event leaves the table untouched.
+ */
+template<typename Key, typename KeyComparator, typename Value>
+class xrEmitterKeyTable
+{
+public:
+    Value* find(const Key& key)
+    {
+        auto result = d_map.find(key);
+        return result != d_map.end() ? &result->second : nullptr;
+    }
+
+    Value& get(const Key& key)
+    {
+        return d_map[key];
+    }
+
+    template<typename Fx>
+    void for_each(Fx fx)
+    {
+        for (auto& entry : d_map)
+            fx(entry.second);
+    }
+
+private:
+    std::map<Key, Value, KeyComparator> d_map;
+};
+
+/**
+ * \brief Interned ids are dense, so subscriber lists are indexed directly by id value.
+ * Growing a deque keeps existing lists in place, which an emit in progress relies on.
+ */
+template<typename KeyComparator, typename Value>
+class xrEmitterKeyTable<xrEventId, KeyComparator, Value>
+{
+public:
+    Value* find(const xrEventId& key)
+    {
+        return key.value() < d_values.size() ? &d_values[key.value()] : nullptr;
+    }
+
+    Value& get(const xrEventId& key)
+    {
+        R_ASSERT(key.valid());
+
+        while (key.value() >= d_values.size())
+            d_values.emplace_back();
+
+        return d_values[key.value()];
+    }
+
+    template<typename Fx>
+    void for_each(Fx fx)
+    {
+        for (auto& value : d_values)
+            fx(value);
+    }
+
+private:
+    std::deque<Value> d_values;
+};
@@ -0,0 +1,6 @@
+﻿#include "stdafx.h"
+#include "xrEventId.h"
+
+XRCORE_API std::mutex xrEventIdRegistry::d_lock;
+XRCORE_API std::unordered_multimap<uint64_t, xrEventId::value_type> xrEventIdRegistry::d_ids;
+XRCORE_API std::deque<std::string> xrEventIdRegistry::d_names;
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+/**
+ * \brief FNV-1a hash of an event name, usable in constant expressions.
+ */
+constexpr uint64_t xrEventHash(const char* name)
+{
+    uint64_t hash = 14695981039346656037ull;
+    while (*name)
+    {
+        hash ^= static_cast<unsigned char>(*name++);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/**
+ * \brief Dense integer identifier of an interned event name.
+ */
+class xrEventId
+{
+public:
+    using value_type = uint32_t;
+    static constexpr value_type invalid = UINT32_MAX;
+
+    constexpr xrEventId() = default;
+    constexpr explicit xrEventId(value_type value) : d_value(value) {}
+
+    static xrEventId intern(const char* name);
+    static xrEventId intern(uint64_t hash, const char* name);
+
+    /**
+     * \brief Returns the id of an already interned name, or an invalid id. Never interns.
+     */
+    static xrEventId find(const char* name);
+
+    static const char* name(xrEventId id);
+
+    constexpr value_type value() const { return d_value; }
+    constexpr bool valid() const { return d_value != invalid; }
+
+    constexpr bool operator==(const xrEventId& other) const { return d_value == other.d_value; }
+    constexpr bool operator!=(const xrEventId& other) const { return d_value != other.d_value; }
+    constexpr bool operator<(const xrEventId& other) const { return d_value < other.d_value; }
+
+private:
+    value_type d_value = invalid;
+};
+
+class XRCORE_API xrEventIdRegistry
+{
+    friend class xrEventId;
+
+    static xrEventId intern(uint64_t hash, const char* name)
+    {
+        std::lock_guard<std::mutex> lock(d_lock);
+
+        auto result = lookup(hash, name);
+        if (result.valid())
+            return result;
+
+        auto id = static_cast<xrEventId::value_type>(d_names.size());
+        d_names.emplace_back(name);
+        d_ids.emplace(hash, id);
+        return xrEventId(id);
+    }
+
+    static xrEventId find(uint64_t hash, const char* name)
+    {
+        std::lock_guard<std::mutex> lock(d_lock);
+        return lookup(hash, name);
+    }
+
+    // Different names may share a hash, each of them gets its own id
+    static xrEventId lookup(uint64_t hash, const char* name)
+    {
+        auto range = d_ids.equal_range(hash);
+        for (auto entry = range.first; entry != range.second; ++entry)
+        {
+            if (d_names[entry->second] == name)
+                return xrEventId(entry->second);
+        }
+
+        return xrEventId();
+    }
+
+    static const char* name(xrEventId id)
+    {
+        std::lock_guard<std::mutex> lock(d_lock);
+        return id.value() < d_names.size() ? d_names[id.value()].c_str() : nullptr;
+    }
+
+    static std::mutex d_lock;
+    static std::unordered_multimap<uint64_t, xrEventId::value_type> d_ids;
+    // Never moves its strings, pointers returned by name() stay valid while names are interned
+    static std::deque<std::string> d_names;
+};
+
+inline xrEventId xrEventId::intern(const char* name)
+{
+    return xrEventIdRegistry::intern(xrEventHash(name), name);
+}
+
+inline xrEventId xrEventId::intern(uint64_t hash, const char* name)
+{
+    return xrEventIdRegistry::intern(hash, name);
+}
+
+inline xrEventId xrEventId::find(const char* name)
+{
+    return xrEventIdRegistry::find(xrEventHash(name), name);
+}
+
+inline const char* xrEventId::name(xrEventId id)
+{
+    return xrEventIdRegistry::name(id);
+}
+
+// Interns a literal event name once per call site, the hash is computed at compile time.
+#define XR_EVENT_ID(name) \
+    ([]() -> xrEventId \
+    { \
+        static const xrEventId id = xrEventId::intern(std::integral_constant<uint64_t, xrEventHash(name)>::value, name); \
+        return id; \
+    }())
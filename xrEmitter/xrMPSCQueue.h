@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+
+struct xrMPSCNode
+{
+    std::atomic<xrMPSCNode*> d_next { nullptr };
+};
+
+/**
+ * \brief Intrusive unbounded multi-producer / single-consumer queue (Vyukov).
+ * push() is wait-free and may be called from any thread, pop() only from the consumer thread.
+ * Nodes are owned by the caller, T must derive from xrMPSCNode.
+ */
+template<typename T>
+class xrMPSCQueue
+{
+public:
+    xrMPSCQueue() : d_head(&d_stub), d_tail(&d_stub) {}
+
+    xrMPSCQueue(const xrMPSCQueue& other) = delete;
+    xrMPSCQueue(xrMPSCQueue&& other) = delete;
+    xrMPSCQueue& operator=(const xrMPSCQueue& other) = delete;
+    xrMPSCQueue& operator=(xrMPSCQueue&& other) = delete;
+
+    void push(T* item)
+    {
+        push_node(item);
+    }
+
+    /**
+     * \brief Returns the oldest node, or nullptr when the queue is empty or the
+     * next producer has not finished linking its node yet.
+     */
+    T* pop()
+    {
+        xrMPSCNode* tail = d_tail;
+        xrMPSCNode* next = tail->d_next.load(std::memory_order_acquire);
+
+        if (tail == &d_stub)
+        {
+            if (next == nullptr)
+                return nullptr;
+
+            d_tail = next;
+            tail = next;
+            next = next->d_next.load(std::memory_order_acquire);
+        }
+
+        if (next != nullptr)
+        {
+            d_tail = next;
+            return static_cast<T*>(tail);
+        }
+
+        if (tail != d_head.load(std::memory_order_acquire))
+            return nullptr;
+
+        push_node(&d_stub);
+
+        next = tail->d_next.load(std::memory_order_acquire);
+        if (next != nullptr)
+        {
+            d_tail = next;
+            return static_cast<T*>(tail);
+        }
+
+        return nullptr;
+    }
+
+    bool empty() const
+    {
+        return d_tail == &d_stub && d_stub.d_next.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    void push_node(xrMPSCNode* node)
+    {
+        node->d_next.store(nullptr, std::memory_order_relaxed);
+        xrMPSCNode* prev = d_head.exchange(node, std::memory_order_acq_rel);
+        prev->d_next.store(node, std::memory_order_release);
+    }
+
+    alignas(64) std::atomic<xrMPSCNode*> d_head;
+    alignas(64) xrMPSCNode* d_tail;
+    xrMPSCNode d_stub;
+};
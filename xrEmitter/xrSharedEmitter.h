@@ -1,53 +1,259 @@
 ﻿#pragma once
 #include "xrEmitter.h"
+#include "xrMPSCQueue.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <shared_mutex>
 #include <thread>
+#include <typeinfo>
+
+enum EVENT_QUEUE_POLICY
+{
+    EVENT_QUEUE_ALL,    // every emitted event is queued and invoked
+    EVENT_QUEUE_LAST,   // a pending event is replaced in place by the newer one
+    EVENT_QUEUE_MERGE   // a newer event is folded into the pending one by a combiner
+};
 
 template<typename Key, typename KeyComparator = std::less<Key>>
-class xrSharedEmitterType : public xrEmitterType<Key>
+class xrSharedEmitterType : public xrEmitterType<Key, KeyComparator>
 {
 public:
     xrSharedEmitterType() : d_thread_id(std::this_thread::get_id()) {}
 
-    void dispatch()
+    ~xrSharedEmitterType()
     {
-        while (!d_internal_event_queue.empty())
-        {
-            auto& e = d_internal_event_queue.front();
-            d_current_emitter.emit_impl(e->d_event, e->d_args);
-            d_internal_event_queue.pop_front();
-        }
+        while (auto e = d_event_queue.pop())
+            release(e);
+    }
+
+    /**
+     * \brief Sets how queued events of the key are coalesced, EVENT_QUEUE_ALL by default.
+     * Policies should be set up before the key is emitted.
+     */
+    void setQueuePolicy(const Key& event, EVENT_QUEUE_POLICY policy)
+    {
+        R_ASSERT(policy != EVENT_QUEUE_MERGE);
+
+        std::unique_lock<std::shared_mutex> lock(d_policies_lock);
+        d_policies.get(event).d_policy = policy;
+        d_has_policies.store(true, std::memory_order_release);
+    }
+
+    /**
+     * \brief Sets EVENT_QUEUE_MERGE policy for the key. The combiner is called as
+     * combiner(std::tuple<Args...>& pending, std::tuple<Args...>& incoming) on the emitting thread,
+     * Args are taken from its parameters and must match the arguments the key is emitted with.
+     */
+    template<typename Fx>
+    void setQueuePolicy(const Key& event, Fx combiner)
+    {
+        setMergePolicy(event, BindDelegate(combiner));
+    }
+
+    // dispatch() overloads invoke queued events and must be called from the thread that created
+    // the emitter. They return the number of events still queued. A time budget always lets
+    // at least one event through so a saturated frame still makes progress.
+    size_t dispatch()
+    {
+        return dispatch_impl(SIZE_MAX, nullptr);
+    }
+
+    size_t dispatch(size_t max_events)
+    {
+        return dispatch_impl(max_events, nullptr);
+    }
+
+    template<typename Rep, typename Period>
+    size_t dispatch(const std::chrono::duration<Rep, Period>& budget, size_t max_events = SIZE_MAX)
+    {
+        auto deadline = std::chrono::steady_clock::now() + budget;
+        return dispatch_impl(max_events, &deadline);
+    }
+
+    size_t queued() const
+    {
+        return d_queued.load(std::memory_order_relaxed);
     }
 
     void clearEventsQueue()
     {
-        auto thread = std::this_thread::get_id();
-        if (thread == d_thread_id)
-            d_internal_event_queue.clear();
-        else
-            d_current_event_queue.clear();
+        R_ASSERT(std::this_thread::get_id() == d_thread_id);
+
+        while (auto e = d_event_queue.pop())
+        {
+            d_queued.fetch_sub(1, std::memory_order_relaxed);
+            release(e);
+        }
     }
 
 protected:
-    void emit_impl(const Key& event, xrDelegateArguments* args) override
+    // Events may be emitted from any thread, they are queued until the owner calls dispatch()
+    void emit_impl(const Key& event, xrDelegateArguments& args) override
     {
-        auto thread = std::this_thread::get_id();
-        if (thread == d_thread_id)
-            d_internal_event_queue.emplace_back(std::make_shared<Event>(event, args));
+        auto e = new Event(event, args.clone());
+
+        if (d_has_policies.load(std::memory_order_acquire))
+        {
+            QueueSlot* slot = nullptr;
+            {
+                std::shared_lock<std::shared_mutex> lock(d_policies_lock);
+                slot = d_policies.find(event);
+            }
+
+            if (slot && slot->d_policy != EVENT_QUEUE_ALL)
+            {
+                e = coalesce(*slot, event, e);
+                if (!e)
+                    return;
+            }
+        }
+
+        d_queued.fetch_add(1, std::memory_order_relaxed);
+        d_event_queue.push(e);
+    }
+
+    size_t dispatch_impl(size_t max_events, const std::chrono::steady_clock::time_point* deadline)
+    {
+        R_ASSERT(std::this_thread::get_id() == d_thread_id);
+
+        // Consecutive events with the same key share one subscriber list lookup
+        typename xrEmitterType<Key, KeyComparator>::SubscribersList* subscribers = nullptr;
+        Key run_key {};
+        bool run_started = false;
+
+        size_t dispatched = 0;
+        while (dispatched < max_events)
+        {
+            if (deadline && dispatched != 0 && std::chrono::steady_clock::now() >= *deadline)
+                break;
+
+            auto e = d_event_queue.pop();
+            if (!e)
+                break;
+
+            d_queued.fetch_sub(1, std::memory_order_relaxed);
+
+            if (!run_started || !same_key(run_key, e->d_event))
+            {
+                run_key = e->d_event;
+                subscribers = d_current_emitter.d_map.find(run_key);
+                run_started = true;
+            }
+
+            if (e->d_slot)
+                e = take_pending(e);
+
+            if (e && subscribers)
+                subscribers->invoke(*e->d_args);
+
+            delete e;
+            ++dispatched;
+        }
+
+        return queued();
+    }
+
+    template<typename ... Args>
+    void setMergePolicy(const Key& event, xrDelegate<void(std::tuple<Args...>&, std::tuple<Args...>&)> combiner)
+    {
+        static_assert(sizeof ... (Args) > 0, "events without arguments have nothing to merge, use EVENT_QUEUE_LAST");
+
+        std::unique_lock<std::shared_mutex> lock(d_policies_lock);
+        auto& slot = d_policies.get(event);
+        slot.d_policy = EVENT_QUEUE_MERGE;
+        slot.d_arguments = &typeid(xrDelegateArgumentsTypes<Args...>);
+        slot.d_combiner = [combiner](xrDelegateArguments& pending, xrDelegateArguments& incoming)
+        {
+            combiner(pending.get<Args...>().values(), incoming.get<Args...>().values());
+        };
+        d_has_policies.store(true, std::memory_order_release);
+    }
+
+    struct Event;
+
+    struct QueueSlot
+    {
+        EVENT_QUEUE_POLICY d_policy = EVENT_QUEUE_ALL;
+        xrDelegate<void(xrDelegateArguments&, xrDelegateArguments&)> d_combiner;
+        // Argument pack type the combiner expects
+        const std::type_info* d_arguments = nullptr;
+        // Latest not yet dispatched event of the key, its marker is already queued
+        std::atomic<Event*> d_pending { nullptr };
+        std::mutex d_merge_lock;
+    };
+
+    // Returns the marker to enqueue, or nullptr when the event was folded into a pending one
+    Event* coalesce(QueueSlot& slot, const Key& event, Event* e)
+    {
+        // Once published e may be replaced and freed by another producer at any moment
+        if (slot.d_policy == EVENT_QUEUE_LAST)
+        {
+            if (auto previous = slot.d_pending.exchange(e, std::memory_order_acq_rel))
+            {
+                delete previous;
+                return nullptr;
+            }
+        }
         else
-            d_current_event_queue.emplace_back(std::make_shared<Event>(event, args));
+        {
+            // The key was emitted with arguments other than the combiner's
+            R_ASSERT(typeid(*e->d_args) == *slot.d_arguments);
+
+            std::lock_guard<std::mutex> lock(slot.d_merge_lock);
+            if (auto pending = slot.d_pending.load(std::memory_order_relaxed))
+            {
+                slot.d_combiner(*pending->d_args, *e->d_args);
+                delete e;
+                return nullptr;
+            }
+            slot.d_pending.store(e, std::memory_order_relaxed);
+        }
+
+        auto marker = new Event(event, nullptr);
+        marker->d_slot = &slot;
+        return marker;
     }
 
-    void push_impl(const Key& event, xrAbstractDelegate<void>* handler) override
+    // Swaps a queued marker for the event currently pending in its slot
+    Event* take_pending(Event* marker)
+    {
+        auto& slot = *marker->d_slot;
+        delete marker;
+
+        if (slot.d_policy == EVENT_QUEUE_MERGE)
+        {
+            std::lock_guard<std::mutex> lock(slot.d_merge_lock);
+            return slot.d_pending.exchange(nullptr, std::memory_order_acq_rel);
+        }
+
+        return slot.d_pending.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+    void release(Event* e)
+    {
+        if (e->d_slot)
+            e = take_pending(e);
+        delete e;
+    }
+
+    static bool same_key(const Key& a, const Key& b)
+    {
+        KeyComparator comparator;
+        return !comparator(a, b) && !comparator(b, a);
+    }
+
+    xrEmitterHandle push_impl(const Key& event, xrAbstractDelegate<void>& handler) override
     {
         auto thread = std::this_thread::get_id();
 
         if (thread == d_thread_id)
-            d_current_emitter.d_map[event].push_back(handler);
+            return d_current_emitter.push_impl(event, handler);
         else
-            d_internal_emitter.d_map[event].push_back(handler);
+            return d_internal_emitter.push_impl(event, handler);
     }
 
-    void pop_impl(const Key& event, xrAbstractDelegate<void>* handler) override
+    void pop_impl(const Key& event, const xrAbstractDelegate<void>& handler) override
     {
         auto thread = std::this_thread::get_id();
         if (thread == d_thread_id)
@@ -56,17 +262,36 @@ protected:
             d_internal_emitter.pop_impl(event, handler);
     }
 
-    struct Event
+    void pop_impl(const Key& event, xrEmitterHandle handle) override
+    {
+        auto thread = std::this_thread::get_id();
+        if (thread == d_thread_id)
+            d_current_emitter.pop_impl(event, handle);
+        else
+            d_internal_emitter.pop_impl(event, handle);
+    }
+
+    struct Event : xrMPSCNode
     {
         Event(const Key& event, xrDelegateArguments* xrDelegateArguments)
             : d_event(event), d_args(xrDelegateArguments) {}
 
+        ~Event()
+        {
+            delete d_args;
+        }
+
         Key d_event;
         xrDelegateArguments* d_args = nullptr;
+        QueueSlot* d_slot = nullptr;
     };
 
-    std::deque<std::shared_ptr<Event>> d_current_event_queue;
-    std::deque<std::shared_ptr<Event>> d_internal_event_queue;
+    xrMPSCQueue<Event> d_event_queue;
+    std::atomic<size_t> d_queued { 0 };
+
+    xrEmitterKeyTable<Key, KeyComparator, QueueSlot> d_policies;
+    std::shared_mutex d_policies_lock;
+    std::atomic<bool> d_has_policies { false };
 
     xrEmitterType<Key, KeyComparator> d_current_emitter;
     xrEmitterType<Key, KeyComparator> d_internal_emitter;
@@ -74,4 +299,5 @@ protected:
     std::thread::id d_thread_id;
 };
 
-using xrSharedEmitter = xrSharedEmitterType<const char*, CharCompare>;
\ No newline at end of file
+using xrSharedEmitter = xrSharedEmitterType<const char*, CharCompare>;
+using xrSharedEventEmitter = xrSharedEmitterType<xrEventId>;
\ No newline at end of file
@@ -0,0 +1,266 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "../xrDelegate/xrDelegate.h"
+
+/**
+ * \brief Identifies a subscription. Stale handles (already unsubscribed) are ignored.
+ */
+struct xrEmitterHandle
+{
+    uint32_t index = UINT32_MAX;
+    uint32_t generation = 0;
+
+    bool valid() const
+    {
+        return index != UINT32_MAX;
+    }
+};
+
+/**
+ * \brief Subscribers of one event, stored by value in a contiguous array in subscription order.
+ * Unsubscribing only marks the slot as dead, dead slots are compacted once they outnumber
+ * the live ones. While an emit is in progress the array is never reallocated or reordered:
+ * new subscribers are kept aside and appended when the outermost emit returns.
+ */
+class xrSubscriberList
+{
+public:
+    using Delegate = xrAbstractDelegate<void>;
+
+    // Every xrDelegate has the same layout regardless of its signature.
+    static constexpr size_t slot_size = sizeof(xrDelegate<void()>);
+
+    xrSubscriberList() = default;
+    xrSubscriberList(const xrSubscriberList& other) = delete;
+    xrSubscriberList(xrSubscriberList&& other) = delete;
+    xrSubscriberList& operator=(const xrSubscriberList& other) = delete;
+    xrSubscriberList& operator=(xrSubscriberList&& other) = delete;
+    ~xrSubscriberList() = default;
+
+    /**
+     * \brief Moves the delegate into the list.
+     */
+    xrEmitterHandle push(Delegate& delegate)
+    {
+        uint32_t index;
+        if (!d_free_handles.empty())
+        {
+            index = d_free_handles.back();
+            d_free_handles.pop_back();
+        }
+        else
+        {
+            index = static_cast<uint32_t>(d_handles.size());
+            d_handles.emplace_back();
+        }
+
+        auto& entry = d_handles[index];
+        entry.pending = d_emitting != 0;
+
+        auto& slots = entry.pending ? d_pending : d_slots;
+        entry.position = static_cast<uint32_t>(slots.size());
+        slots.emplace_back(delegate, index);
+
+        return { index, entry.generation };
+    }
+
+    bool pop(xrEmitterHandle handle)
+    {
+        if (handle.index >= d_handles.size() || d_handles[handle.index].generation != handle.generation)
+            return false;
+
+        auto& entry = d_handles[handle.index];
+        release(entry.pending ? d_pending[entry.position] : d_slots[entry.position]);
+        return true;
+    }
+
+    /**
+     * \brief Removes the first subscriber equal to the delegate.
+     */
+    bool pop(const Delegate& delegate)
+    {
+        for (auto* slots : { &d_slots, &d_pending })
+        {
+            for (auto& slot : *slots)
+            {
+                if (slot.alive() && *slot.get() == delegate)
+                {
+                    release(slot);
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void invoke(xrDelegateArguments& args)
+    {
+        ++d_emitting;
+
+        // Size is captured up front, subscribers added by handlers are not invoked by this emit
+        const size_t count = d_slots.size();
+        for (size_t pos = 0; pos < count; ++pos)
+        {
+            auto& slot = d_slots[pos];
+            if (slot.alive())
+                slot.get()->invoke_args(args);
+        }
+
+        if (--d_emitting == 0)
+            flush();
+    }
+
+    size_t size() const
+    {
+        return d_slots.size() + d_pending.size() - d_dead;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+private:
+    class Slot
+    {
+    public:
+        Slot(Delegate& delegate, uint32_t handle) : d_handle(handle)
+        {
+            delegate.move_to(d_storage);
+        }
+
+        // A released slot stays in the array until compact(), moving it must not revive its storage
+        Slot(Slot&& other) noexcept : d_handle(other.d_handle), d_alive(other.d_alive), d_constructed(false)
+        {
+            if (other.d_constructed)
+            {
+                other.get()->move_to(d_storage);
+                other.destroy();
+                d_constructed = true;
+            }
+        }
+
+        Slot& operator=(Slot&& other) noexcept
+        {
+            if (this == &other)
+                return *this;
+            destroy();
+            d_handle = other.d_handle;
+            d_alive = other.d_alive;
+            if (other.d_constructed)
+            {
+                other.get()->move_to(d_storage);
+                other.destroy();
+                d_constructed = true;
+            }
+            return *this;
+        }
+
+        Slot(const Slot& other) = delete;
+        Slot& operator=(const Slot& other) = delete;
+
+        ~Slot()
+        {
+            destroy();
+        }
+
+        Delegate* get()
+        {
+            return std::launder(reinterpret_cast<Delegate*>(d_storage));
+        }
+
+        void destroy()
+        {
+            if (d_constructed)
+                get()->~Delegate();
+            d_constructed = false;
+        }
+
+        bool alive() const { return d_alive; }
+        void kill() { d_alive = false; }
+        uint32_t handle() const { return d_handle; }
+
+    private:
+        alignas(std::max_align_t) unsigned char d_storage[slot_size];
+        uint32_t d_handle;
+        bool d_alive = true;
+        bool d_constructed = true;
+    };
+
+    struct Handle
+    {
+        uint32_t position = 0;
+        uint32_t generation = 0;
+        bool pending = false;
+    };
+
+    void release(Slot& slot)
+    {
+        if (!slot.alive())
+            return;
+
+        slot.kill();
+        ++d_dead;
+
+        // A running handler may be unsubscribing itself, its delegate is destroyed after the emit
+        if (d_emitting == 0)
+            slot.destroy();
+
+        auto& entry = d_handles[slot.handle()];
+        ++entry.generation;
+        d_free_handles.push_back(slot.handle());
+
+        if (d_emitting == 0 && d_dead * 2 > d_slots.size())
+            compact();
+    }
+
+    void flush()
+    {
+        if (!d_pending.empty())
+        {
+            for (auto& slot : d_pending)
+            {
+                if (slot.alive())
+                {
+                    auto& entry = d_handles[slot.handle()];
+                    entry.position = static_cast<uint32_t>(d_slots.size());
+                    entry.pending = false;
+                }
+                d_slots.push_back(std::move(slot));
+            }
+            d_pending.clear();
+        }
+
+        if (d_dead != 0)
+            compact();
+    }
+
+    void compact()
+    {
+        size_t target = 0;
+        for (size_t pos = 0; pos < d_slots.size(); ++pos)
+        {
+            auto& slot = d_slots[pos];
+            if (!slot.alive())
+                continue;
+
+            if (target != pos)
+                d_slots[target] = std::move(slot);
+
+            d_handles[d_slots[target].handle()].position = static_cast<uint32_t>(target);
+            ++target;
+        }
+
+        d_slots.erase(d_slots.begin() + target, d_slots.end());
+        d_dead = 0;
+    }
+
+    std::vector<Slot> d_slots;
+    std::vector<Slot> d_pending;
+    std::vector<Handle> d_handles;
+    std::vector<uint32_t> d_free_handles;
+    size_t d_dead = 0;
+    unsigned d_emitting = 0;
+};
@@ -1,4 +1,7 @@
 #pragma once
+#include <algorithm>
+#include <utility>
+#include <vector>
 #include "xrDelegate/xrDelegate.h"
 #include "xrArrayHelpers.h"
 
@@ -16,41 +19,124 @@ public:
     template<typename TFunction>
     void subscribe(TFunction fx) const
     {        
-        d_subscribers.push_back(BindDelegate(fx));        
+        add(BindDelegate(fx));
     }
 
     template<typename TClass, typename TFunction>
     void subscribe(TClass tx, TFunction fx) const
     {
-        d_subscribers.push_back(BindDelegate(tx, fx));
+        add(BindDelegate(tx, fx));
     }
 
     template<typename TFunction>
     void unsubscribe(TFunction fx) const
     {
-        auto self = BindDelegate(fx);
-        array_eraseif(d_subscribers, [self](const xrDelegate<void(Args...)>& delegate)
-        {
-            return self == delegate;
-        });
+        remove(BindDelegate(fx));
     }
 
     template<typename TClass, typename TFunction>
     void unsubscribe(TClass tx, TFunction fx) const
     {
-        auto self = BindDelegate(tx, fx);
-        array_eraseif(d_subscribers, [self](const xrDelegate<void(Args...)>& delegate)
-        {
-            return self == delegate;
-        });
+        remove(BindDelegate(tx, fx));
     }  
 
-    void operator()(Args...args)
+    /**
+     * \brief Calls the subscribers in place. Value arguments are moved into the last subscriber,
+     * the ones before it get copies. Handlers may subscribe and unsubscribe: new subscribers are
+     * first called by the next invocation, removed ones are skipped at once and freed when the
+     * outermost invocation returns.
+     */
+    void operator()(Args ... args)
     {
-        for (auto it : d_subscribers)
-            it(args...);
+        ++d_invoking;
+
+        const size_t count = d_subscribers.size();
+        size_t last = count;
+        while (last > 0 && !d_subscribers[last - 1].d_alive)
+            --last;
+
+        for (size_t pos = 0; pos < count; ++pos)
+        {
+            auto& subscriber = d_subscribers[pos];
+            if (!subscriber.d_alive)
+                continue;
+
+            if (pos + 1 == last)
+                subscriber.d_delegate(std::forward<Args>(args)...);
+            else
+                subscriber.d_delegate(args...);
+        }
+
+        if (--d_invoking == 0 && d_modified)
+            flush();
     }
 
 private:
-    mutable std::vector<xrDelegate<void(Args...)>> d_subscribers;
+    using Delegate = xrDelegate<void(Args...)>;
+
+    struct Subscriber
+    {
+        Delegate d_delegate;
+        bool d_alive = true;
+    };
+
+    void add(Delegate delegate) const
+    {
+        // The array must not reallocate under a running invocation
+        if (d_invoking != 0)
+        {
+            d_pending.push_back({ std::move(delegate) });
+            d_modified = true;
+        }
+        else
+            d_subscribers.push_back({ std::move(delegate) });
+    }
+
+    void remove(const Delegate& delegate) const
+    {
+        // Every subscription of the delegate goes, whether or not an invocation is running
+        if (d_invoking == 0)
+        {
+            d_subscribers.erase(std::remove_if(d_subscribers.begin(), d_subscribers.end(), [&delegate](const Subscriber& subscriber)
+            {
+                return subscriber.d_delegate == delegate;
+            }), d_subscribers.end());
+            return;
+        }
+
+        // A handler may be removing itself, its delegate stays alive until flush()
+        for (auto* subscribers : { &d_subscribers, &d_pending })
+        {
+            for (auto& subscriber : *subscribers)
+            {
+                if (subscriber.d_alive && subscriber.d_delegate == delegate)
+                {
+                    subscriber.d_alive = false;
+                    d_modified = true;
+                }
+            }
+        }
+    }
+
+    void flush() const
+    {
+        d_subscribers.erase(std::remove_if(d_subscribers.begin(), d_subscribers.end(), [](const Subscriber& subscriber)
+        {
+            return !subscriber.d_alive;
+        }), d_subscribers.end());
+
+        for (auto& subscriber : d_pending)
+        {
+            if (subscriber.d_alive)
+                d_subscribers.push_back(std::move(subscriber));
+        }
+
+        d_pending.clear();
+        d_modified = false;
+    }
+
+    mutable std::vector<Subscriber> d_subscribers;
+    mutable std::vector<Subscriber> d_pending;
+    size_t d_invoking = 0;
+    mutable bool d_modified = false;
 };
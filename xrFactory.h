@@ -79,13 +79,13 @@ public:
 
     void uninject() override
     {
-        d_object = nullptr;
+        this->d_object = nullptr;
     }
 
 private:
     template<typename TupleType, std::size_t... index>
     void inject_type(TupleType& tup, std::index_sequence<index...>) {        
-        d_object = xrFactory::get<T>(std::get<index>(tup)...);
+        this->d_object = xrFactory::get<T>(std::get<index>(tup)...);
     }
 
     std::tuple<Args...> d_args;
@@ -112,13 +112,13 @@ public:
 
     void uninject() override
     {
-        d_object = nullptr;
+        this->d_object = nullptr;
     }
 
 private:
     template<typename TupleType, std::size_t... index>
     void inject_type(TupleType& tup, std::index_sequence<index...>) {
-        d_object = xrFactory::getShared<T>(std::get<index>(tup)...);
+        this->d_object = xrFactory::getShared<T>(std::get<index>(tup)...);
     }
 
     std::tuple<Args...> d_args;
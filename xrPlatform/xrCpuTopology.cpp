@@ -0,0 +1,150 @@
+﻿#include "stdafx.h"
+#include "xrCpuTopology.h"
+#include <algorithm>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <cstdio>
+#include <cstdlib>
+#endif
+
+#ifndef _WIN32
+// Parses a sysfs cpu list such as "0-3,8-11"
+static std::vector<u32> parseCpuList(const char* text)
+{
+    std::vector<u32> result;
+    while (*text)
+    {
+        char* end = nullptr;
+        u32 first = static_cast<u32>(strtoul(text, &end, 10));
+        if (end == text)
+            break;
+
+        u32 last = first;
+        text = end;
+        if (*text == '-')
+        {
+            last = static_cast<u32>(strtoul(text + 1, &end, 10));
+            text = end;
+        }
+
+        for (u32 index = first; index <= last; index++)
+            result.push_back(index);
+
+        while (*text == ',' || *text == '\n')
+            text++;
+    }
+    return result;
+}
+
+static bool readCpuList(const char* path, std::vector<u32>& list)
+{
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return false;
+
+    char buffer[1024] = {};
+    size_t size = fread(buffer, 1, sizeof(buffer) - 1, file);
+    fclose(file);
+
+    buffer[size] = 0;
+    list = parseCpuList(buffer);
+    return true;
+}
+#endif
+
+xrCpuTopology xrCpuTopology::query()
+{
+    xrCpuTopology topology;
+
+#ifdef _WIN32
+    DWORD_PTR process_mask = 0, system_mask = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask))
+    {
+        for (u32 index = 0; index < sizeof(DWORD_PTR) * 8; index++)
+        {
+            if (!(process_mask & (DWORD_PTR(1) << index)))
+                continue;
+
+            UCHAR node = 0;
+            if (!GetNumaProcessorNode(static_cast<UCHAR>(index), &node) || node == 0xff)
+                node = 0;
+
+            topology.processors.push_back({ index, node });
+        }
+    }
+#else
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        for (u32 index = 0; index < CPU_SETSIZE; index++)
+        {
+            if (CPU_ISSET(index, &allowed))
+                topology.processors.push_back({ index, 0 });
+        }
+    }
+
+    // Online node ids may have gaps, e.g. after hot-unplug or on memory-only nodes
+    std::vector<u32> nodes, cpus;
+    readCpuList("/sys/devices/system/node/online", nodes);
+
+    for (auto node : nodes)
+    {
+        char path[64];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+        if (!readCpuList(path, cpus))
+            continue;
+
+        for (auto& processor : topology.processors)
+        {
+            if (std::find(cpus.begin(), cpus.end(), processor.index) != cpus.end())
+                processor.node = node;
+        }
+    }
+#endif
+
+    if (topology.processors.empty())
+    {
+        u32 count = std::max(std::thread::hardware_concurrency(), 1u);
+        for (u32 index = 0; index < count; index++)
+            topology.processors.push_back({ index, 0 });
+    }
+
+    std::stable_sort(topology.processors.begin(), topology.processors.end(),
+        [](const Processor& a, const Processor& b) { return a.node < b.node; });
+
+    topology.nodes = topology.processors.back().node + 1;
+    return topology;
+}
+
+bool xrSetCurrentThreadAffinity(const std::vector<u32>& processors)
+{
+    if (processors.empty())
+        return false;
+
+#ifdef _WIN32
+    DWORD_PTR mask = 0;
+    for (auto index : processors)
+    {
+        if (index < sizeof(DWORD_PTR) * 8)
+            mask |= DWORD_PTR(1) << index;
+    }
+
+    return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto index : processors)
+    {
+        if (index < CPU_SETSIZE)
+            CPU_SET(index, &set);
+    }
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+/**
+ * \brief Logical processors this process may run on, grouped by NUMA node.
+ * Windows: process affinity mask of the primary processor group, nodes from GetNumaProcessorNode.
+ * Linux: sched_getaffinity, nodes from /sys/devices/system/node.
+ */
+struct XRCORE_API xrCpuTopology
+{
+    struct Processor
+    {
+        u32 index;  // logical processor number as used by the OS
+        u32 node;   // NUMA node, 0 on machines without NUMA information
+    };
+
+    // Ordered by node, then by processor index
+    std::vector<Processor> processors;
+    u32 nodes = 1;
+
+    static xrCpuTopology query();
+};
+
+// Restricts the calling thread to the given logical processors, false if the OS refused
+XRCORE_API bool xrSetCurrentThreadAffinity(const std::vector<u32>& processors);
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif !defined(_WIN32)
+#include <mutex>
+#endif
+
+/**
+ * \brief Short critical section lock, usable with std::lock_guard and std::unique_lock.
+ * Windows: xrCore's xrFastLock. Linux: a three-state futex mutex that stays in user space
+ * unless the lock is contended, with a brief spin before sleeping.
+ */
+class xrLock
+{
+public:
+    xrLock() = default;
+    xrLock(const xrLock& other) = delete;
+    xrLock& operator=(const xrLock& other) = delete;
+
+#if defined(_WIN32)
+    void lock()
+    {
+        d_lock.Enter();
+    }
+
+    void unlock()
+    {
+        d_lock.Leave();
+    }
+
+private:
+    xrFastLock d_lock;
+#elif defined(__linux__)
+    void lock()
+    {
+        int state = unlocked;
+        if (d_state.compare_exchange_strong(state, locked, std::memory_order_acquire, std::memory_order_relaxed))
+            return;
+
+        for (int spin = 0; spin < spin_count; spin++)
+        {
+            state = unlocked;
+            if (d_state.load(std::memory_order_relaxed) == unlocked &&
+                d_state.compare_exchange_weak(state, locked, std::memory_order_acquire, std::memory_order_relaxed))
+                return;
+        }
+
+        // Marked contended, so the holder knows to wake a sleeper on unlock
+        state = d_state.exchange(contended, std::memory_order_acquire);
+        while (state != unlocked)
+        {
+            syscall(SYS_futex, reinterpret_cast<int*>(&d_state), FUTEX_WAIT_PRIVATE, contended, nullptr, nullptr, 0);
+            state = d_state.exchange(contended, std::memory_order_acquire);
+        }
+    }
+
+    void unlock()
+    {
+        if (d_state.exchange(unlocked, std::memory_order_release) == contended)
+            syscall(SYS_futex, reinterpret_cast<int*>(&d_state), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+private:
+    static constexpr int unlocked = 0;
+    static constexpr int locked = 1;
+    static constexpr int contended = 2;
+    static constexpr int spin_count = 64;
+
+    std::atomic<int> d_state { unlocked };
+#else
+    void lock()
+    {
+        d_lock.lock();
+    }
+
+    void unlock()
+    {
+        d_lock.unlock();
+    }
+
+private:
+    std::mutex d_lock;
+#endif
+};
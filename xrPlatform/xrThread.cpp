@@ -0,0 +1,20 @@
+﻿#include "stdafx.h"
+#include "xrThread.h"
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <cstring>
+#endif
+
+void xrInitializeThread(const char* name)
+{
+#ifdef _WIN32
+    thread_name(name);
+    _initialize_cpu_thread();
+#else
+    char short_name[16];
+    strncpy(short_name, name, sizeof(short_name) - 1);
+    short_name[sizeof(short_name) - 1] = 0;
+    pthread_setname_np(pthread_self(), short_name);
+#endif
+}
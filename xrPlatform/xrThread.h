@@ -0,0 +1,7 @@
+#pragma once
+
+/**
+ * \brief Prepares the calling thread to run engine code and names it for debuggers and profilers.
+ * Linux thread names are cut to 15 characters.
+ */
+XRCORE_API void xrInitializeThread(const char* name);
@@ -1,29 +1,105 @@
 ﻿#pragma once
 #include "xrTask.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 #include "../xrArrayHelpers.h"
+#include "../xrFactory.h"
 #include "xrTaskDispatcher.h"
+#include "xrWorkStealingQueue.h"
+#include "../xrPlatform/xrCpuTopology.h"
+#include "../xrPlatform/xrLock.h"
+#include "../xrPlatform/xrThread.h"
 
 using AsyncTaskSharedQueue = std::vector<xrTaskShared>;
 
+enum TASK_AFFINITY
+{
+    TASK_AFFINITY_NONE,     // workers float, the OS scheduler places them
+    TASK_AFFINITY_NODE,     // each worker is kept on the processors of its NUMA node
+    TASK_AFFINITY_CORE      // each worker is pinned to one logical processor
+};
+
+struct xrTaskPoolConfig
+{
+    size_t threads = 0;                             // 0 starts one worker per processor left after the reserved ones
+    size_t reserved_cores = 0;                      // processors kept free for the main and render threads
+    TASK_AFFINITY affinity = TASK_AFFINITY_NONE;
+    bool numa = true;                               // steal from workers of the same node first
+};
+
 class xrAsyncTaskDispatcher
-{    
+{
+    friend class xrTaskGraph;
+    friend class xrParallel;
+    template<typename Dispatcher>
+    friend class xrTaskScheduleAwaiter;
+
 public:
-    xrAsyncTaskDispatcher()
-    {        
-        for (size_t pos = 0; pos < CPU::xrSystemInfo.dwNumberOfProcessors; pos++)
-            d_threads.push_back(new std::thread(&xrAsyncTaskDispatcher::threadDispatcher, this, pos));
+    xrAsyncTaskDispatcher() : xrAsyncTaskDispatcher(d_default_config) {}
+
+    /**
+     * \brief Starts the pool. Workers are spread over the processors left after
+     * reserved_cores, in NUMA node order, so consecutive workers share a node.
+     */
+    explicit xrAsyncTaskDispatcher(const xrTaskPoolConfig& config) : d_config(config)
+    {
+        auto topology = xrCpuTopology::query();
+
+        std::vector<xrCpuTopology::Processor> processors;
+        if (config.reserved_cores < topology.processors.size())
+            processors.assign(topology.processors.begin() + config.reserved_cores, topology.processors.end());
+
+        size_t count = config.threads != 0 ? config.threads : std::max<size_t>(processors.size(), 1);
+        for (size_t pos = 0; pos < count; pos++)
+        {
+            auto worker = new Worker(pos);
+
+            if (!processors.empty())
+            {
+                auto& processor = processors[pos % processors.size()];
+                worker->d_node = processor.node;
+
+                if (config.affinity == TASK_AFFINITY_CORE)
+                    worker->d_processors.push_back(processor.index);
+                else if (config.affinity == TASK_AFFINITY_NODE)
+                {
+                    for (auto& other : processors)
+                    {
+                        if (other.node == processor.node)
+                            worker->d_processors.push_back(other.index);
+                    }
+                }
+            }
+
+            d_workers.push_back(worker);
+        }
+
+        for (auto worker : d_workers)
+            worker->d_thread = new std::thread(&xrAsyncTaskDispatcher::threadDispatcher, this, worker);
+
+        // Workers register their thread dispatchers on startup, don't hand out the pool before that
+        while (d_started.load(std::memory_order_acquire) != d_workers.size())
+            std::this_thread::yield();
     }
 
     ~xrAsyncTaskDispatcher()
     {
         d_terminate = true;
 
-        while (d_terminate)
-            Sleep(0);        
+        for (auto worker : d_workers)
+            signal(*worker);
 
-        for (auto thread : d_threads)
-            delete thread;
+        for (auto worker : d_workers)
+        {
+            worker->d_thread->join();
+            delete worker->d_thread;
+        }
+
+        for (auto worker : d_workers)
+            delete worker;
     }
 
     xrAsyncTaskDispatcher(const xrAsyncTaskDispatcher& other) = delete;
@@ -36,74 +112,365 @@ public:
     {
         auto functor = std::bind(std::forward<Fx>(args)...);
         using TFunctor = decltype(functor);
-        using TResult = typename std::remove_reference<typename std::result_of<TFunctor()>::type>::type;
+        using TResult = std::remove_reference_t<std::invoke_result_t<TFunctor&>>;
         using Task = xrTaskFunction<TFunctor, TResult>;
-        std::shared_ptr<Task> task = std::make_shared<Task>(functor, Priority);
+        std::shared_ptr<Task> task = std::allocate_shared<Task>(xrTaskAllocator<Task>(), functor, Priority);
 		g_async_task_dispatcher.get()->push(task);
         return task;
     }
-    
+
+    // Fire-and-forget: nothing to wait on, the task frees itself after running
+    template<TASK_PRIORITY Priority = TASK_PRIORITY_LOW, typename ... Fx>
+    static void addDetachedTask(Fx ... args)
+    {
+        auto functor = std::bind(std::forward<Fx>(args)...);
+        g_async_task_dispatcher.get()->push(xrTaskInline<decltype(functor)>::create(functor, Priority));
+    }
+
+    // Detached task skipped when token is cancelled before it starts
+    template<TASK_PRIORITY Priority = TASK_PRIORITY_LOW, typename ... Fx>
+    static void addDetachedTask(const xrCancellationToken& token, Fx ... args)
+    {
+        auto functor = std::bind(std::forward<Fx>(args)...);
+        auto task = xrTaskInline<decltype(functor)>::create(functor, Priority);
+        task->setCancellation(token);
+        g_async_task_dispatcher.get()->push(task);
+    }
+
     template<TASK_PRIORITY Priority = TASK_PRIORITY_LOW, typename ... Fx>
     static auto addTaskToQueue(AsyncTaskSharedQueue& queue, Fx ... args)
     {
-        auto task = addTask(args...);        
+        auto task = addTask(args...);
         queue.push_back(task);
         return task;
     }
-    
-    static void waitQueue(AsyncTaskSharedQueue& queue)
+
+    // Returns the number of tasks that were cancelled instead of executed
+    static size_t waitQueue(AsyncTaskSharedQueue& queue)
     {
+        size_t cancelled = 0;
         for (auto& item : queue)
         {
             item->wait();
+            if (item->cancelled())
+                cancelled++;
         }
 		queue.clear();
+        return cancelled;
+    }
+
+    // Cancels the tasks of the queue that have not started yet, running ones are left to finish
+    static size_t cancelQueue(AsyncTaskSharedQueue& queue)
+    {
+        size_t cancelled = 0;
+        for (auto& item : queue)
+        {
+            if (item->cancel())
+                cancelled++;
+        }
+        return cancelled;
+    }
+
+#if defined(__cpp_impl_coroutine)
+    // co_await xrAsyncTaskDispatcher::schedule() continues the coroutine on a pool worker
+    static xrTaskScheduleAwaiter<xrAsyncTaskDispatcher> schedule();
+#endif
+
+    // Used by the default constructor, i.e. when the pool is bound with asSingleton()
+    static void setDefaultConfig(const xrTaskPoolConfig& config)
+    {
+        d_default_config = config;
+    }
+
+    size_t concurrency() const
+    {
+        return d_workers.size();
     }
 
 private:
+    struct Worker
+    {
+        explicit Worker(size_t id) : d_id(id), d_random(static_cast<uint32_t>(id) * 2654435761u + 1) {}
+
+        size_t d_id;
+        // Tasks pushed from this worker's own tasks, stolen by idle workers
+        xrWorkStealingQueue<xrTask> d_deque;
+        // Created on the worker thread, receives then() callbacks of tasks created there
+        xrTaskDispatcher* d_dispatcher = nullptr;
+        std::thread* d_thread = nullptr;
+        uint32_t d_random;
+
+        // NUMA node of the processor the worker was placed on, and its affinity set if pinned
+        u32 d_node = 0;
+        std::vector<u32> d_processors;
+
+        // Adaptive spin before parking: grows when spinning finds work, shrinks when it doesn't
+        size_t d_spin_limit = min_spin;
+        std::mutex d_park_lock;
+        std::condition_variable d_park_event;
+        bool d_signaled = false;
+    };
+
+    static constexpr size_t min_spin = 16;
+    static constexpr size_t max_spin = 1024;
+
     void push(const xrTaskShared& task)
-    {     
-        auto dispatcher = d_thread_dispatchers.at(0);
+    {
+        task->d_owner = task;
+        push(task.get());
+    }
+
+    // Tasks owned elsewhere, e.g. xrTaskGraph nodes, are queued without a self reference
+    void push(xrTask* task)
+    {
+        // Normal tasks spawned by a worker stay on its own deque, everything else goes to the
+        // shared injection queue, which orders them by priority
+        if (t_owner == this && (g_disableTaskPriority || task->getPriority() == TASK_PRIORITY_NORMAL))
+        {
+            task->submitted(t_worker->d_deque);
+            t_worker->d_deque.push(task);
+        }
+        else
+        {
+            task->submitted(d_injection_queue);
+            d_injection_queue.push(task);
+        }
+
+        unparkOne();
+    }
+
+    void signal(Worker& worker)
+    {
+        {
+            std::lock_guard<std::mutex> lock(worker.d_park_lock);
+            worker.d_signaled = true;
+        }
+        worker.d_park_event.notify_one();
+    }
+
+    // Removes the worker from the idle list, returns false if a waker already took it
+    bool unidle(Worker& worker)
+    {
+        std::lock_guard<xrLock> lock(d_idle_lock);
+
+        auto result = std::find(d_idle.begin(), d_idle.end(), &worker);
+        if (result == d_idle.end())
+            return false;
+
+        d_idle.erase(result);
+        d_parked.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Wakes exactly one parked worker, if there is any
+    void unparkOne()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (d_parked.load(std::memory_order_relaxed) == 0)
+            return;
+
+        Worker* worker = nullptr;
+        {
+            std::lock_guard<xrLock> lock(d_idle_lock);
+            if (d_idle.empty())
+                return;
+
+            worker = d_idle.back();
+            d_idle.pop_back();
+            d_parked.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        signal(*worker);
+    }
+
+    // Wakes a specific worker, used when a task is posted to its own thread dispatcher
+    void unpark(Worker& worker)
+    {
+        if (unidle(worker))
+            signal(worker);
+    }
+
+    // Parks the worker until it is signaled. Returns a task found by the final check instead of parking.
+    xrTask* park(Worker& worker)
+    {
+        {
+            std::lock_guard<xrLock> lock(d_idle_lock);
+            d_idle.push_back(&worker);
+            d_parked.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        // Anything pushed before the worker became visible as idle is seen here,
+        // anything pushed after that will signal it
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (d_terminate || worker.d_dispatcher->totalQueued() != 0)
+        {
+            unidle(worker);
+            return nullptr;
+        }
+
+        if (auto task = findTask(worker))
+        {
+            unidle(worker);
+            return task;
+        }
+
+        auto idle_begin = xrTaskProfiler::now();
+        {
+            std::unique_lock<std::mutex> lock(worker.d_park_lock);
+            worker.d_park_event.wait(lock, [&worker] { return worker.d_signaled; });
+            worker.d_signaled = false;
+        }
+        xrTaskProfiler::idle(idle_begin, xrTaskProfiler::now());
+        return nullptr;
+    }
+
+    xrTask* steal(Worker& thief)
+    {
+        const size_t count = d_workers.size();
+        if (count < 2)
+            return nullptr;
+
+        // xorshift32, victims are probed starting from a random worker
+        thief.d_random ^= thief.d_random << 13;
+        thief.d_random ^= thief.d_random >> 17;
+        thief.d_random ^= thief.d_random << 5;
+
+        // Victims on the thief's own node first, their tasks' data is likely in local memory
+        size_t start = thief.d_random % count;
+        for (int pass = d_config.numa ? 0 : 1; pass < 2; pass++)
+        {
+            for (size_t pos = 0; pos < count; pos++)
+            {
+                auto victim = d_workers[(start + pos) % count];
+                if (victim == &thief || (pass == 0 && victim->d_node != thief.d_node))
+                    continue;
+
+                if (auto task = victim->d_deque.steal())
+                {
+                    xrTaskProfiler::stolen();
+                    return task;
+                }
+            }
+        }
+
+        return nullptr;
+    }
 
-	    if (dispatcher->totalQueued() != 0) //Пустая очередь нас и так устроит
-	    {
-		    for (auto& entry : d_thread_dispatchers)
-		    {
-			    if (entry.second->totalQueued() < dispatcher->totalQueued())
-				    dispatcher = entry.second;
-		    }
-	    }
+    // Frame-critical and realtime tasks first, then local work, then anything queued, then stealing
+    xrTask* findTask(Worker& worker)
+    {
+        if (auto task = d_injection_queue.pop(TASK_PRIORITY_FRAME))
+            return task;
+
+        if (auto task = worker.d_deque.pop())
+            return task;
 
-        dispatcher->push(task);
+        if (auto task = d_injection_queue.pop())
+            return task;
+
+        return steal(worker);
     }
 
-    void threadDispatcher(size_t id)
+    // Runs one pending task of the current worker's pool, called by xrTask::wait()
+    static bool help()
     {
-        shared_str temp_str;
-        temp_str.printf("xrAsyncTaskDispatcherThread #%d", id);
-        thread_name(temp_str.c_str());
-        _initialize_cpu_thread();
+        auto worker = t_worker;
+        if (worker->d_dispatcher->totalQueued() != 0)
+        {
+            worker->d_dispatcher->dispatch();
+            return true;
+        }
 
-		auto dispatcher = new xrTaskDispatcher();
+        if (auto task = t_owner->findTask(*worker))
         {
-	        ScopedLock(d_locker);
-			d_thread_dispatchers[id] = dispatcher;
+            task->execute();
+            return true;
         }
+
+        return false;
+    }
+
+    void threadDispatcher(Worker* worker)
+    {
+        // Linux keeps 15 characters of a thread name, the short one leaves room for the index
+        char name[64];
+        snprintf(name, sizeof(name), "xrAsync #%zu", worker->d_id);
+        xrInitializeThread(name);
+        snprintf(name, sizeof(name), "xrAsyncTaskDispatcherThread #%zu", worker->d_id);
+        xrTaskProfiler::setThreadName(name);
+
+        if (!worker->d_processors.empty())
+            xrSetCurrentThreadAffinity(worker->d_processors);
+
+        auto dispatcher = new xrTaskDispatcher();
+
+        dispatcher->d_wakeup = [this, worker]() { unpark(*worker); };
+        worker->d_dispatcher = dispatcher;
+        t_worker = worker;
+        t_owner = this;
+        xrTask::t_help = &xrAsyncTaskDispatcher::help;
+        d_started.fetch_add(1, std::memory_order_release);
+
+        size_t spins = 0;
         while (!d_terminate)
-        {          
-            dispatcher->dispatch();
+        {
+            if (dispatcher->totalQueued() != 0)
+                dispatcher->dispatch();
+
+            if (auto task = findTask(*worker))
+            {
+                if (spins != 0)
+                    worker->d_spin_limit = std::min(worker->d_spin_limit * 2, max_spin);
+                spins = 0;
+                task->execute();
+                continue;
+            }
+
+            if (spins < worker->d_spin_limit)
+            {
+                ++spins;
+                std::this_thread::yield();
+                continue;
+            }
 
-			if (dispatcher->totalQueued() == 0)
-				Sleep(1);
+            worker->d_spin_limit = std::max(worker->d_spin_limit / 2, min_spin);
+            spins = 0;
+
+            if (auto task = park(*worker))
+                task->execute();
         }
 
-        d_terminate = false;
+        while (auto task = worker->d_deque.pop())
+            task->discard();
+
+        t_worker = nullptr;
+        t_owner = nullptr;
+        xrTask::t_help = nullptr;
+
+        delete dispatcher;
     }
-        
-    std::map<size_t, xrTaskDispatcher*> d_thread_dispatchers;    
-    std::vector<std::thread*> d_threads;    
-    volatile bool d_terminate = false;
-    xrFastLock d_locker {};
+
+    xrTaskPoolConfig d_config;
+    std::vector<Worker*> d_workers;
+
+    xrTaskPriorityQueue d_injection_queue;
+
+    std::vector<Worker*> d_idle;
+    std::atomic<size_t> d_parked { 0 };
+    xrLock d_idle_lock;
+
+    std::atomic<bool> d_terminate { false };
+    std::atomic<size_t> d_started { 0 };
+
+    inline static xrTaskPoolConfig d_default_config;
+    inline static thread_local Worker* t_worker = nullptr;
+    inline static thread_local xrAsyncTaskDispatcher* t_owner = nullptr;
 	IC static xrInject<xrAsyncTaskDispatcher>	g_async_task_dispatcher;
 };
 
+#if defined(__cpp_impl_coroutine)
+inline xrTaskScheduleAwaiter<xrAsyncTaskDispatcher> xrAsyncTaskDispatcher::schedule()
+{
+    return xrTaskScheduleAwaiter<xrAsyncTaskDispatcher>(g_async_task_dispatcher.get());
+}
+#endif
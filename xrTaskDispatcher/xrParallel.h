@@ -0,0 +1,184 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include "xrAsyncTaskDispatcher.h"
+
+/**
+ * \brief Fork-join helpers on xrAsyncTaskDispatcher workers. Ranges are split recursively in
+ * halves: one half is queued as a stack-allocated task, which idle workers steal, and the other
+ * half is processed in place. No task is heap allocated, and waiting workers keep helping.
+ */
+class xrParallel
+{
+public:
+    // Chunks per worker when the grain is chosen automatically, leaves room for load balancing
+    static constexpr size_t chunks_per_worker = 8;
+
+    template<typename Index>
+    static Index autoGrain(Index begin, Index end)
+    {
+        size_t count = static_cast<size_t>(end - begin);
+        size_t grain = count / (concurrency() * chunks_per_worker);
+        return static_cast<Index>(grain != 0 ? grain : 1);
+    }
+
+    static size_t concurrency()
+    {
+        return xrAsyncTaskDispatcher::g_async_task_dispatcher.get()->concurrency();
+    }
+
+    // Runs left() in place and right() as a task that any worker may pick up
+    template<typename Left, typename Right>
+    static void fork(Left&& left, Right&& right)
+    {
+        Task<Right> task(right);
+        xrAsyncTaskDispatcher::g_async_task_dispatcher.get()->push(&task);
+        left();
+        task.wait();
+    }
+
+    template<typename Index, typename Fx>
+    static void forRange(Index begin, Index end, Index grain, Fx& fn)
+    {
+        if (end - begin <= grain)
+        {
+            if (begin != end)
+                fn(begin, end);
+            return;
+        }
+
+        Index middle = begin + (end - begin) / 2;
+        fork(
+            [&] { forRange(begin, middle, grain, fn); },
+            [&] { forRange(middle, end, grain, fn); });
+    }
+
+    template<typename Index, typename T, typename Fx, typename Combine>
+    static T reduceRange(Index begin, Index end, Index grain, const T& identity, Fx& fn, Combine& combine)
+    {
+        if (end - begin <= grain)
+            return begin != end ? fn(begin, end) : identity;
+
+        Index middle = begin + (end - begin) / 2;
+        T left = identity;
+        T right = identity;
+        fork(
+            [&] { left = reduceRange(begin, middle, grain, identity, fn, combine); },
+            [&] { right = reduceRange(middle, end, grain, identity, fn, combine); });
+
+        return combine(left, right);
+    }
+
+    template<typename Iterator, typename Compare>
+    static void sortRange(Iterator first, Iterator last, size_t cutoff, Compare& comp)
+    {
+        if (static_cast<size_t>(last - first) <= cutoff)
+        {
+            std::sort(first, last, comp);
+            return;
+        }
+
+        // Median of three as pivot, partition in three so runs of equal keys don't recurse
+        Iterator middle = first + (last - first) / 2;
+        auto pivot = medianOfThree(*first, *middle, *(last - 1), comp);
+
+        Iterator lower = std::partition(first, last, [&](const auto& item) { return comp(item, pivot); });
+        Iterator upper = std::partition(lower, last, [&](const auto& item) { return !comp(pivot, item); });
+
+        fork(
+            [&] { sortRange(first, lower, cutoff, comp); },
+            [&] { sortRange(upper, last, cutoff, comp); });
+    }
+
+private:
+    template<typename Fx>
+    class Task : public xrTask
+    {
+    public:
+        explicit Task(Fx& functor) : xrTask(TASK_PRIORITY_LOW), d_functor(functor) {}
+
+        // The task lives on the forking thread's stack, it must not outlive a pending execution
+        ~Task()
+        {
+            wait();
+        }
+
+    protected:
+        void invoke() override
+        {
+            if (!start())
+                return;
+
+            d_functor();
+            finish();
+        }
+
+    private:
+        Fx& d_functor;
+    };
+
+    template<typename T, typename Compare>
+    static T medianOfThree(const T& a, const T& b, const T& c, Compare& comp)
+    {
+        if (comp(a, b))
+            return comp(b, c) ? b : (comp(a, c) ? c : a);
+
+        return comp(a, c) ? a : (comp(b, c) ? c : b);
+    }
+};
+
+/**
+ * \brief Calls fn(chunk_begin, chunk_end) for disjoint chunks covering [begin, end),
+ * chunks are at most grain long. Returns after every chunk is processed.
+ */
+template<typename Index, typename Fx>
+void parallel_for(Index begin, Index end, Index grain, Fx fn)
+{
+    if (end <= begin)
+        return;
+
+    xrParallel::forRange(begin, end, grain > 0 ? grain : 1, fn);
+}
+
+template<typename Index, typename Fx>
+void parallel_for(Index begin, Index end, Fx fn)
+{
+    if (end <= begin)
+        return;
+
+    xrParallel::forRange(begin, end, xrParallel::autoGrain(begin, end), fn);
+}
+
+/**
+ * \brief Reduces [begin, end): fn(chunk_begin, chunk_end) returns the value of a chunk and
+ * combine(a, b) joins values of adjacent chunks, in order. identity is returned for an empty range.
+ */
+template<typename Index, typename T, typename Fx, typename Combine>
+T parallel_reduce(Index begin, Index end, Index grain, T identity, Fx fn, Combine combine)
+{
+    if (end <= begin)
+        return identity;
+
+    return xrParallel::reduceRange(begin, end, grain > 0 ? grain : 1, identity, fn, combine);
+}
+
+template<typename Index, typename T, typename Fx, typename Combine>
+T parallel_reduce(Index begin, Index end, T identity, Fx fn, Combine combine)
+{
+    if (end <= begin)
+        return identity;
+
+    return xrParallel::reduceRange(begin, end, xrParallel::autoGrain(begin, end), identity, fn, combine);
+}
+
+template<typename Iterator, typename Compare = std::less<typename std::iterator_traits<Iterator>::value_type>>
+void parallel_sort(Iterator first, Iterator last, Compare comp = Compare())
+{
+    // Below the cutoff a range is sorted serially, splitting further costs more than it saves
+    constexpr size_t min_cutoff = 2048;
+
+    size_t count = static_cast<size_t>(last - first);
+    size_t cutoff = std::max(count / (xrParallel::concurrency() * xrParallel::chunks_per_worker), min_cutoff);
+    xrParallel::sortRange(first, last, cutoff, comp);
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+/**
+ * \brief Futex-style wait/notify keyed by address. Waiters block on one of a fixed set of
+ * striped condition variables, so waitable objects need no per-object kernel state.
+ */
+class XRCORE_API xrParkingLot
+{
+public:
+    // Blocks until condition() returns true, it is re-checked after every notify on the address
+    template<typename Fx>
+    static void wait(const void* address, Fx condition)
+    {
+        auto& bucket = getBucket(address);
+        std::unique_lock<std::mutex> lock(bucket.d_lock);
+        while (!condition())
+            bucket.d_event.wait(lock);
+    }
+
+    // The caller publishes its state change before notifying
+    static void notifyAll(const void* address)
+    {
+        auto& bucket = getBucket(address);
+        {
+            std::lock_guard<std::mutex> lock(bucket.d_lock);
+        }
+        bucket.d_event.notify_all();
+    }
+
+private:
+    struct alignas(64) Bucket
+    {
+        std::mutex d_lock;
+        std::condition_variable d_event;
+    };
+
+    static constexpr size_t bucket_count = 64;
+
+    static Bucket& getBucket(const void* address)
+    {
+        auto value = reinterpret_cast<uintptr_t>(address);
+        return d_buckets[((value >> 4) ^ (value >> 10)) % bucket_count];
+    }
+
+    static Bucket d_buckets[bucket_count];
+};
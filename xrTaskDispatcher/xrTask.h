@@ -1,25 +1,94 @@
 ﻿#pragma once
 #include "../xrDelegate/xrDelegate.h"
+#include "xrParkingLot.h"
+#include "xrTaskMemory.h"
+#include "xrTaskProfiler.h"
+#include <atomic>
+#include <chrono>
 
+class xrTask;
 class xrTaskDispatcher;
+class xrTaskPriorityQueue;
+
+using xrTaskShared = std::shared_ptr<xrTask>;
 
 enum TASK_PRIORITY
 {
-    TASK_PRIORITY_LOW = u8(0),    
-    TASK_PRIORITY_HIGH,
+    TASK_PRIORITY_BACKGROUND = u8(0),   // streaming, I/O and other work that may lag behind
+    TASK_PRIORITY_NORMAL,
+    TASK_PRIORITY_FRAME,                // needed to finish the current frame
+    TASK_PRIORITY_REALTIME,             // audio, input and other latency critical work
+    TASK_PRIORITY_COUNT,
+
+    TASK_PRIORITY_LOW = TASK_PRIORITY_NORMAL,
+    TASK_PRIORITY_HIGH = TASK_PRIORITY_FRAME,
+};
+
+// What happens to a task that reaches the front of its queue after its deadline
+enum TASK_DEADLINE
+{
+    TASK_DEADLINE_DROP,     // not executed, waiters see STATE_EXPIRED
+    TASK_DEADLINE_DEFER     // moved to TASK_PRIORITY_BACKGROUND and executed later
 };
 
 enum TASK_STATE
 {    
     STATE_WAIT,
     STATE_WORKING,
-    STATE_READY
+    STATE_READY,
+    STATE_EXPIRED,
+    STATE_CANCELLED
+};
+
+/**
+ * \brief Shared cancellation flag. Copies refer to the same flag, so one token can be handed
+ * to a whole group of tasks. Cancelling skips the tasks that have not started yet; running
+ * tasks stop early only if they poll cancelled() themselves.
+ */
+class xrCancellationToken
+{
+    friend class xrTask;
+
+public:
+    xrCancellationToken() : d_flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel()
+    {
+        d_flag->store(true, std::memory_order_release);
+    }
+
+    bool cancelled() const
+    {
+        return d_flag->load(std::memory_order_acquire);
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> d_flag;
+};
+
+/**
+ * \brief Intrusive node queued on a task with xrTask::addContinuation(). run() is called once,
+ * on the thread that completes the task, after its final state is visible.
+ */
+class xrTaskContinuation
+{
+    friend class xrTask;
+
+public:
+    virtual void run() = 0;
+
+protected:
+    ~xrTaskContinuation() = default;
+
+private:
+    xrTaskContinuation* d_next = nullptr;
 };
 
 class xrTask
 {
     friend class xrTaskDispatcher;
     friend class xrAsyncTaskDispatcher;
+    friend class xrTaskPriorityQueue;
 
 public:
     xrTask(TASK_PRIORITY priority) : d_taskPriority(priority) {}    
@@ -29,25 +98,60 @@ public:
     xrTask& operator=(xrTask&& other) noexcept = delete;
     virtual ~xrTask() = default;
 
+    /**
+     * \brief Blocks until the task is done. On a worker thread other pending tasks are
+     * executed while waiting, the thread only blocks when there is nothing left to help with.
+     */
     void wait() const
     {
-        while (d_taskState != STATE_READY)
-            Sleep(1);
+        if (done())
+            return;
+
+        if (t_help)
+        {
+            while (!done())
+            {
+                if (!t_help())
+                    break;
+            }
+        }
+
+        if (done())
+            return;
+
+        d_taskState.fetch_or(state_waited, std::memory_order_seq_cst);
+        xrParkingLot::wait(this, [this] { return done(); });
+    }
+
+    // Executed, expired or cancelled, the task will not change anymore
+    bool done() const
+    {
+        return state() >= STATE_READY;
     }
 
     bool ready() const
     {
-        return d_taskState == STATE_READY;
+        return state() == STATE_READY;
+    }
+
+    bool expired() const
+    {
+        return state() == STATE_EXPIRED;
+    }
+
+    bool cancelled() const
+    {
+        return state() == STATE_CANCELLED;
     }
 
     bool waiting() const
     {
-        return d_taskState == STATE_WAIT;
+        return state() == STATE_WAIT;
     }
 
     bool working() const
     {
-        return d_taskState == STATE_WORKING;
+        return state() == STATE_WORKING;
     }
 
     TASK_PRIORITY getPriority() const
@@ -55,42 +159,380 @@ public:
         return d_taskPriority;
     }
 
-    void setPriority(TASK_PRIORITY priority)
+    // A task still waiting in a priority queue is moved to the new level
+    void setPriority(TASK_PRIORITY priority);
+
+    /**
+     * \brief Sets the latest time the task should start at. A late task is dropped when it is
+     * about to run; deferring applies to tasks waiting in a priority queue, which move to the
+     * background level. Tasks already running are not affected.
+     */
+    void setDeadline(std::chrono::steady_clock::time_point deadline, TASK_DEADLINE policy = TASK_DEADLINE_DROP)
     {
-        d_taskPriority = priority;
-    }    
+        d_deadlinePolicy.store(policy, std::memory_order_relaxed);
+        d_deadline.store(deadline.time_since_epoch().count(), std::memory_order_release);
+    }
+
+    template<typename Rep, typename Period>
+    void setDeadline(const std::chrono::duration<Rep, Period>& timeout, TASK_DEADLINE policy = TASK_DEADLINE_DROP)
+    {
+        setDeadline(std::chrono::steady_clock::now() + timeout, policy);
+    }
+
+    bool hasDeadline() const
+    {
+        return d_deadline.load(std::memory_order_acquire) != no_deadline;
+    }
+
+    // Cancels the task if it has not started yet, false when it is already running or done
+    bool cancel()
+    {
+        if (!start())
+            return false;
+
+        complete(STATE_CANCELLED);
+        return true;
+    }
+
+    /**
+     * \brief Skips the task once token is cancelled, unless it is already running. May be set
+     * after the task was queued, but only once.
+     */
+    void setCancellation(const xrCancellationToken& token)
+    {
+        R_ASSERT(d_cancellation.load(std::memory_order_relaxed) == nullptr);
+
+        d_cancellationFlag = token.d_flag;
+        d_cancellation.store(token.d_flag.get(), std::memory_order_release);
+    }
+
+    bool cancellationRequested() const
+    {
+        auto flag = d_cancellation.load(std::memory_order_acquire);
+        return flag && flag->load(std::memory_order_acquire);
+    }
+
+    // Name of the task in profiler traces, a string that outlives the task. Set after queuing,
+    // it may miss a task that already started.
+    void setLabel(const char* label)
+    {
+        if constexpr (xrTaskProfiler::enabled)
+            d_label.store(label, std::memory_order_relaxed);
+    }
+
+    /**
+     * \brief Queues continuation to run when the task is done. Returns false, without queuing,
+     * if the task has already completed; the caller then proceeds by itself.
+     */
+    bool addContinuation(xrTaskContinuation* continuation)
+    {
+        auto head = d_continuations.load(std::memory_order_acquire);
+        do
+        {
+            if (head == continuations_closed())
+                return false;
+
+            continuation->d_next = head;
+        } while (!d_continuations.compare_exchange_weak(head, continuation,
+            std::memory_order_acq_rel, std::memory_order_acquire));
+
+        return true;
+    }
 
 protected:
     virtual void invoke() = 0;
-    volatile short d_taskState = STATE_WAIT;
-    volatile bool d_taskCaptured = false;
-    volatile TASK_PRIORITY d_taskPriority;    
+
+    // Drops a task that is still queued when its dispatcher is destroyed
+    virtual void discard()
+    {
+        d_owner = nullptr;
+    }
+
+    // Runs a queued task and drops the reference the queue was holding
+    void execute()
+    {
+        if (cancellationRequested())
+        {
+            xrTaskProfiler::dropped();
+            drop(STATE_CANCELLED);
+            return;
+        }
+
+        if (late() && d_deadlinePolicy.load(std::memory_order_relaxed) == TASK_DEADLINE_DROP)
+        {
+            xrTaskProfiler::dropped();
+            drop(STATE_EXPIRED);
+            return;
+        }
+
+        xrTaskShared owner = std::move(d_owner);
+        if constexpr (xrTaskProfiler::enabled)
+        {
+            // Detached tasks free themselves in invoke()
+            auto label = d_label.load(std::memory_order_relaxed);
+            auto submit_time = d_submitTime;
+            auto begin = xrTaskProfiler::now();
+            invoke();
+            xrTaskProfiler::executed(label, submit_time, begin, xrTaskProfiler::now());
+        }
+        else
+            invoke();
+    }
+
+    // Called by dispatchers right before the task is pushed to queue
+    template<typename Queue>
+    void submitted(const Queue& queue)
+    {
+        if constexpr (xrTaskProfiler::enabled)
+        {
+            d_submitTime = xrTaskProfiler::now();
+            xrTaskProfiler::submitted(queue.size());
+        }
+    }
+
+    bool late() const
+    {
+        auto deadline = d_deadline.load(std::memory_order_acquire);
+        return deadline != no_deadline && std::chrono::steady_clock::now().time_since_epoch().count() >= deadline;
+    }
+
+    // Claims the task for execution, false if another thread already started it
+    bool start()
+    {
+        short current = d_taskState.load(std::memory_order_relaxed);
+        do
+        {
+            if ((current & state_mask) != STATE_WAIT)
+                return false;
+        } while (!d_taskState.compare_exchange_weak(current, (current & ~state_mask) | STATE_WORKING,
+            std::memory_order_acquire, std::memory_order_relaxed));
+
+        return true;
+    }
+
+    // Publishes the results written by invoke() and wakes blocked waiters.
+    // The task is not touched afterwards, a waiter may destroy it as soon as it sees READY.
+    void finish()
+    {
+        complete(STATE_READY);
+    }
+
+    // Skips a queued task that is cancelled or past its deadline instead of executing it
+    virtual void drop(TASK_STATE state)
+    {
+        xrTaskShared owner = std::move(d_owner);
+
+        if (start())
+            complete(state);
+    }
+
+    void complete(TASK_STATE state)
+    {
+        // Continuations are detached before the state is published, nothing of the task is
+        // touched once it is visible as done
+        auto continuations = d_continuations.exchange(continuations_closed(), std::memory_order_acq_rel);
+
+        if (d_taskState.exchange(state, std::memory_order_seq_cst) & state_waited)
+            xrParkingLot::notifyAll(this);
+
+        // Pushed as a stack, run in the order they were added
+        xrTaskContinuation* ordered = nullptr;
+        while (continuations)
+        {
+            auto next = continuations->d_next;
+            continuations->d_next = ordered;
+            ordered = continuations;
+            continuations = next;
+        }
+
+        while (ordered)
+        {
+            auto next = ordered->d_next;
+            ordered->run();
+            ordered = next;
+        }
+    }
+
+    // Makes a finished task runnable again, only valid while nobody waits on it
+    void reset()
+    {
+        d_continuations.store(nullptr, std::memory_order_relaxed);
+        d_taskState.store(STATE_WAIT, std::memory_order_relaxed);
+    }
+
+    static xrTaskContinuation* continuations_closed()
+    {
+        return reinterpret_cast<xrTaskContinuation*>(uintptr_t(1));
+    }
+
+    short state() const
+    {
+        return d_taskState.load(std::memory_order_acquire) & state_mask;
+    }
+
+    // TASK_STATE in the low bits, state_waited set once a thread blocks on the task
+    static constexpr short state_mask = 0xff;
+    static constexpr short state_waited = 0x100;
+
+    // Queues hold raw pointers, a shared task keeps itself alive until it is executed
+    xrTaskShared d_owner;
+    mutable std::atomic<short> d_taskState { STATE_WAIT };
+    volatile TASK_PRIORITY d_taskPriority;
+
+    // steady_clock ticks, may be set while the task is already queued
+    static constexpr std::chrono::steady_clock::rep no_deadline = std::chrono::steady_clock::time_point::max().time_since_epoch().count();
+    std::atomic<std::chrono::steady_clock::rep> d_deadline { no_deadline };
+    std::atomic<TASK_DEADLINE> d_deadlinePolicy { TASK_DEADLINE_DROP };
+
+    // Priority queue currently holding the task, lets setPriority() move it between levels
+    std::atomic<xrTaskPriorityQueue*> d_taskQueue { nullptr };
+
+    // Flag of the token set with setCancellation(), kept alive by the shared reference
+    std::atomic<const std::atomic<bool>*> d_cancellation { nullptr };
+    std::shared_ptr<std::atomic<bool>> d_cancellationFlag;
+
+    // Profiler data, present with profiling disabled too so the layout never depends on it
+    std::atomic<const char*> d_label { nullptr };
+    int64_t d_submitTime = 0;
+
+    // Added continuations, continuations_closed() once the task completed
+    std::atomic<xrTaskContinuation*> d_continuations { nullptr };
+
+    // Set on worker threads: runs one other pending task, false when there was none
+    inline static thread_local bool (*t_help)() = nullptr;
 };
 
+/**
+ * \brief Task returning a value. Any number of then() callbacks may be added, before or after
+ * the task finished; they all read the one stored result.
+ */
 template<typename Functor, typename TResult>
-class xrTaskFunction : public xrTask
+class xrTaskFunction : public xrTask, public std::enable_shared_from_this<xrTaskFunction<Functor, TResult>>
 {
-    using CallbackFunction = std::conditional_t<std::is_same_v<TResult, void>,
-        std::function<void()>,
-        std::function<void(TResult)>>;
-
     using TaskCallbackType = std::conditional_t<std::is_same_v<TResult, void>, int, TResult>;        
 
 public:
     xrTaskFunction(Functor& functor, TASK_PRIORITY priority);
 
+    /**
+     * \brief Calls callback with the result once the task is ready, as a task on the dispatcher
+     * of the thread that created this task. Called right away if the task is already ready,
+     * never if it expired.
+     */
     template<typename ... Fx>
     void then(Fx&& ... callback);
 
+    // Value returned by the functor, valid once the task is ready
+    decltype(auto) get() const
+    {
+        R_ASSERT(ready());
+
+        if constexpr (!std::is_same_v<TResult, void>)
+            return static_cast<const TResult&>(d_result);
+    }
+
 protected:
     void invoke() override;
 
 private:
+    template<typename Callback>
+    void addCallback(Callback& callback);
+
     Functor d_functor;
     xrTaskDispatcher* d_dispatcher = nullptr;
-    CallbackFunction d_callback;
-    xrFastLock d_lock;
     TaskCallbackType d_result;
 };
 
-using xrTaskShared = std::shared_ptr<xrTask>;
+/**
+ * \brief Fire-and-forget task: holds the callable inline, has no result, callback or shared
+ * ownership, and returns its memory to xrTaskMemory right after running.
+ */
+template<typename Functor>
+class xrTaskInline : public xrTask
+{
+public:
+    static xrTaskInline* create(Functor& functor, TASK_PRIORITY priority)
+    {
+        return new (xrTaskMemory::allocate(sizeof(xrTaskInline))) xrTaskInline(functor, priority);
+    }
+
+protected:
+    void invoke() override
+    {
+        d_functor();
+        destroy();
+    }
+
+    void discard() override
+    {
+        destroy();
+    }
+
+    // Nobody observes the state of a task without a handle
+    void drop(TASK_STATE) override
+    {
+        destroy();
+    }
+
+private:
+    xrTaskInline(Functor& functor, TASK_PRIORITY priority) : xrTask(priority), d_functor(functor) {}
+
+    void destroy()
+    {
+        this->~xrTaskInline();
+        xrTaskMemory::deallocate(this, sizeof(xrTaskInline));
+    }
+
+    Functor d_functor;
+};
+
+/**
+ * \brief Continuation added by xrTaskFunction::then(). Once the source task completes it is
+ * queued as a task on the given dispatcher, or run inline when there is none, and frees
+ * itself after running.
+ */
+template<typename Functor>
+class xrTaskCallback : public xrTask, public xrTaskContinuation
+{
+    template<typename, typename>
+    friend class xrTaskFunction;
+
+public:
+    static xrTaskCallback* create(Functor& functor, TASK_PRIORITY priority, xrTaskDispatcher* dispatcher)
+    {
+        return new (xrTaskMemory::allocate(sizeof(xrTaskCallback))) xrTaskCallback(functor, priority, dispatcher);
+    }
+
+    void run() override;
+
+protected:
+    void invoke() override
+    {
+        d_functor();
+        destroy();
+    }
+
+    void discard() override
+    {
+        destroy();
+    }
+
+    // Nobody observes the state of a task without a handle
+    void drop(TASK_STATE) override
+    {
+        destroy();
+    }
+
+private:
+    xrTaskCallback(Functor& functor, TASK_PRIORITY priority, xrTaskDispatcher* dispatcher)
+        : xrTask(priority), d_functor(functor), d_dispatcher(dispatcher) {}
+
+    void destroy()
+    {
+        this->~xrTaskCallback();
+        xrTaskMemory::deallocate(this, sizeof(xrTaskCallback));
+    }
+
+    Functor d_functor;
+    xrTaskDispatcher* d_dispatcher;
+};
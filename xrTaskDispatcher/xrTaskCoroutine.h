@@ -0,0 +1,339 @@
+#pragma once
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include "xrTaskDispatcher.h"
+
+/**
+ * \brief Suspends a coroutine until a task is done. The coroutine is resumed on the
+ * dispatcher of the thread it was suspended on, or inline on the completing thread when
+ * that thread has no dispatcher. The awaiter lives in the coroutine frame and is queued
+ * as a task itself, so an await allocates nothing.
+ */
+class xrTaskAwaiter : public xrTask, public xrTaskContinuation
+{
+public:
+    explicit xrTaskAwaiter(xrTask& task) : xrTask(TASK_PRIORITY_NORMAL), d_task(task) {}
+
+    bool await_ready() const noexcept
+    {
+        return d_task.done();
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle)
+    {
+        d_handle = handle;
+        d_dispatcher = xrTaskDispatcher::getCurrentThreadDispatcher();
+
+        // Nothing of the awaiter may be touched once queued, the coroutine can already be running
+        return d_task.addContinuation(this);
+    }
+
+    void await_resume() const
+    {
+        // The task may complete between await_ready() and publishing its state
+        d_task.wait();
+    }
+
+protected:
+    void run() override
+    {
+        if (d_dispatcher && d_dispatcher != xrTaskDispatcher::getCurrentThreadDispatcher())
+            d_dispatcher->push(static_cast<xrTask*>(this));
+        else
+            d_handle.resume();
+    }
+
+    void invoke() override
+    {
+        d_handle.resume();
+    }
+
+    xrTask& d_task;
+    xrTaskDispatcher* d_dispatcher = nullptr;
+    std::coroutine_handle<> d_handle;
+};
+
+// Thrown from co_await on a task that was cancelled or dropped past its deadline, it has no result
+class xrTaskCancelled : public std::runtime_error
+{
+public:
+    explicit xrTaskCancelled(TASK_STATE state)
+        : std::runtime_error(state == STATE_EXPIRED ? "awaited task expired" : "awaited task cancelled"), d_state(state) {}
+
+    // STATE_CANCELLED or STATE_EXPIRED
+    TASK_STATE state() const
+    {
+        return d_state;
+    }
+
+private:
+    TASK_STATE d_state;
+};
+
+// Awaits a task and returns its result, holding a reference so the task outlives the await
+template<typename Task>
+class xrTaskResultAwaiter : public xrTaskAwaiter
+{
+public:
+    explicit xrTaskResultAwaiter(std::shared_ptr<Task> task) : xrTaskAwaiter(*task), d_result_task(std::move(task)) {}
+
+    decltype(auto) await_resume() const
+    {
+        xrTaskAwaiter::await_resume();
+        if (!d_result_task->ready())
+            throw xrTaskCancelled(d_result_task->expired() ? STATE_EXPIRED : STATE_CANCELLED);
+
+        return d_result_task->get();
+    }
+
+private:
+    std::shared_ptr<Task> d_result_task;
+};
+
+template<typename Functor, typename TResult>
+xrTaskResultAwaiter<xrTaskFunction<Functor, TResult>> operator co_await(const std::shared_ptr<xrTaskFunction<Functor, TResult>>& task)
+{
+    return xrTaskResultAwaiter<xrTaskFunction<Functor, TResult>>(task);
+}
+
+/**
+ * \brief Always suspends and queues the coroutine on the dispatcher, resuming it on one of
+ * the dispatcher's threads. Returned by schedule() of xrTaskDispatcher and xrAsyncTaskDispatcher.
+ */
+template<typename Dispatcher>
+class xrTaskScheduleAwaiter : public xrTask
+{
+public:
+    explicit xrTaskScheduleAwaiter(Dispatcher* dispatcher) : xrTask(TASK_PRIORITY_NORMAL), d_dispatcher(dispatcher) {}
+
+    bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        d_handle = handle;
+        d_dispatcher->push(static_cast<xrTask*>(this));
+    }
+
+    void await_resume() const noexcept {}
+
+protected:
+    void invoke() override
+    {
+        d_handle.resume();
+    }
+
+private:
+    Dispatcher* d_dispatcher;
+    std::coroutine_handle<> d_handle;
+};
+
+inline xrTaskScheduleAwaiter<xrTaskDispatcher> xrTaskDispatcher::schedule()
+{
+    return xrTaskScheduleAwaiter<xrTaskDispatcher>(this);
+}
+
+template<typename T>
+class xrCoroutine;
+
+/**
+ * \brief Coroutine state is a task: it can be waited on and awaited like any other task.
+ * The frame is shared by the running coroutine and its xrCoroutine handle, the last one
+ * to let go destroys it.
+ */
+class xrCoroutinePromiseBase : public xrTask
+{
+public:
+    xrCoroutinePromiseBase() : xrTask(TASK_PRIORITY_NORMAL) {}
+
+    std::suspend_never initial_suspend() noexcept
+    {
+        return {};
+    }
+
+    template<typename Promise>
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        // Resumes (and so destroys the frame) when the handle was already dropped
+        bool await_suspend(std::coroutine_handle<Promise> handle) noexcept
+        {
+            auto& promise = handle.promise();
+            promise.finish();
+            return !promise.release();
+        }
+
+        void await_resume() const noexcept {}
+    };
+
+    void unhandled_exception()
+    {
+        d_exception = std::current_exception();
+    }
+
+    // True for the last of the coroutine and its handle
+    bool release()
+    {
+        return d_references.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+protected:
+    void invoke() override {}
+
+    void rethrow() const
+    {
+        if (d_exception)
+            std::rethrow_exception(d_exception);
+    }
+
+    std::exception_ptr d_exception;
+    std::atomic<int> d_references { 2 };
+};
+
+template<typename T>
+class xrCoroutinePromise : public xrCoroutinePromiseBase
+{
+public:
+    xrCoroutine<T> get_return_object();
+
+    FinalAwaiter<xrCoroutinePromise> final_suspend() noexcept
+    {
+        return {};
+    }
+
+    template<typename V>
+    void return_value(V&& value)
+    {
+        d_value.emplace(std::forward<V>(value));
+    }
+
+    T& get()
+    {
+        rethrow();
+        return *d_value;
+    }
+
+private:
+    std::optional<T> d_value;
+};
+
+template<>
+class xrCoroutinePromise<void> : public xrCoroutinePromiseBase
+{
+public:
+    xrCoroutine<void> get_return_object();
+
+    FinalAwaiter<xrCoroutinePromise> final_suspend() noexcept
+    {
+        return {};
+    }
+
+    void return_void() {}
+
+    void get()
+    {
+        rethrow();
+    }
+};
+
+/**
+ * \brief Return type of task coroutines. The coroutine starts running immediately on the
+ * calling thread; co_await schedule() moves it to a dispatcher, co_await on a task or
+ * another xrCoroutine suspends it until the result is ready.
+ */
+template<typename T = void>
+class xrCoroutine
+{
+public:
+    using promise_type = xrCoroutinePromise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    explicit xrCoroutine(handle_type handle) : d_handle(handle) {}
+
+    xrCoroutine(xrCoroutine&& other) noexcept : d_handle(std::exchange(other.d_handle, nullptr)) {}
+
+    xrCoroutine& operator=(xrCoroutine&& other) noexcept
+    {
+        if (this != &other)
+        {
+            drop();
+            d_handle = std::exchange(other.d_handle, nullptr);
+        }
+        return *this;
+    }
+
+    xrCoroutine(const xrCoroutine& other) = delete;
+    xrCoroutine& operator=(const xrCoroutine& other) = delete;
+
+    ~xrCoroutine()
+    {
+        drop();
+    }
+
+    void wait() const
+    {
+        d_handle.promise().wait();
+    }
+
+    bool ready() const
+    {
+        return d_handle.promise().ready();
+    }
+
+    // Waits for the coroutine and returns its result, rethrows an escaped exception
+    decltype(auto) get() const
+    {
+        wait();
+        return d_handle.promise().get();
+    }
+
+    auto operator co_await() const
+    {
+        struct Awaiter : xrTaskAwaiter
+        {
+            explicit Awaiter(promise_type& promise) : xrTaskAwaiter(promise), d_promise(promise) {}
+
+            decltype(auto) await_resume() const
+            {
+                xrTaskAwaiter::await_resume();
+                return d_promise.get();
+            }
+
+            promise_type& d_promise;
+        };
+
+        return Awaiter(d_handle.promise());
+    }
+
+private:
+    void drop()
+    {
+        if (d_handle && d_handle.promise().release())
+            d_handle.destroy();
+    }
+
+    handle_type d_handle;
+};
+
+template<typename T>
+xrCoroutine<T> xrCoroutinePromise<T>::get_return_object()
+{
+    return xrCoroutine<T>(xrCoroutine<T>::handle_type::from_promise(*this));
+}
+
+inline xrCoroutine<void> xrCoroutinePromise<void>::get_return_object()
+{
+    return xrCoroutine<void>(xrCoroutine<void>::handle_type::from_promise(*this));
+}
+
+#endif
@@ -1,4 +1,35 @@
 ﻿#include "stdafx.h"
 #include "xrTaskDispatcher.h"
+#include "xrParkingLot.h"
+#include "xrTaskMemory.h"
+#include "xrTaskProfiler.h"
 
-XRCORE_API xrTaskDispatcher::DispatcherThreadMap xrTaskDispatcher::d_dispatchersMap;
\ No newline at end of file
+XRCORE_API xrTaskDispatcher::DispatcherRegistry xrTaskDispatcher::d_dispatchers;
+XRCORE_API xrParkingLot::Bucket xrParkingLot::d_buckets[xrParkingLot::bucket_count];
+XRCORE_API xrTaskMemory::Central xrTaskMemory::d_central;
+
+XRCORE_API std::mutex xrTaskProfiler::d_lock;
+XRCORE_API std::vector<xrTaskProfiler::Thread*> xrTaskProfiler::d_threads;
+
+// Kept out of the exported class, thread local data can't have a DLL interface
+static thread_local xrTaskDispatcher* t_current_dispatcher = nullptr;
+
+xrTaskDispatcher::xrTaskDispatcher()
+{
+    d_thread_id = std::this_thread::get_id();
+    d_dispatchers.insert(d_thread_id, this);
+    t_current_dispatcher = this;
+}
+
+xrTaskDispatcher::~xrTaskDispatcher()
+{
+    d_dispatchers.erase(d_thread_id, this);
+
+    if (t_current_dispatcher == this)
+        t_current_dispatcher = nullptr;
+}
+
+xrTaskDispatcher* xrTaskDispatcher::getCurrentThreadDispatcher()
+{
+    return t_current_dispatcher;
+}
@@ -1,24 +1,28 @@
 ﻿#pragma once
+#include <atomic>
 #include <thread>
 #include "xrTask.h"
+#include "xrTaskPriorityQueue.h"
+#include "xrThreadRegistry.h"
 
-constexpr bool g_disableTaskPriority = true;
+#if defined(__cpp_impl_coroutine)
+template<typename Dispatcher>
+class xrTaskScheduleAwaiter;
+#endif
 
 class XRCORE_API xrTaskDispatcher
 {
     friend class xrAsyncTaskDispatcher;
+    friend class xrTaskAwaiter;
+    template<typename Functor>
+    friend class xrTaskCallback;
+    template<typename Dispatcher>
+    friend class xrTaskScheduleAwaiter;
 
 public:
-    xrTaskDispatcher() 
-    {
-        d_thread_id = std::this_thread::get_id();
-        d_dispatchersMap[d_thread_id] = this;
-    }
-
-    virtual ~xrTaskDispatcher() 
-    {
-        d_dispatchersMap[d_thread_id] = nullptr;
-    }
+    // A dispatcher belongs to the thread that creates it
+    xrTaskDispatcher();
+    virtual ~xrTaskDispatcher();
 
     xrTaskDispatcher(const xrTaskDispatcher& other) = delete;
     xrTaskDispatcher(xrTaskDispatcher&& other) = delete;
@@ -30,76 +34,92 @@ public:
     {   
         auto functor = std::bind(std::forward<Fx>(args)...);
         using TFunctor = decltype(functor);
-        using TResult = typename std::remove_reference<typename std::result_of<TFunctor()>::type>::type;
+        using TResult = std::remove_reference_t<std::invoke_result_t<TFunctor&>>;
         using Task = xrTaskFunction<TFunctor, TResult>;
-        std::shared_ptr<Task> task = std::make_shared<Task>(functor, Priority);
+        std::shared_ptr<Task> task = std::allocate_shared<Task>(xrTaskAllocator<Task>(), functor, Priority);
         push(task);
         return task;
     }
 
+    // Fire-and-forget: nothing to wait on, the task frees itself after running
+    template<TASK_PRIORITY Priority = TASK_PRIORITY_LOW, typename ... Fx>
+    void addDetachedTask(Fx ... args)
+    {
+        auto functor = std::bind(std::forward<Fx>(args)...);
+        push(xrTaskInline<decltype(functor)>::create(functor, Priority));
+    }
+
+    // Detached task skipped when token is cancelled before it starts
+    template<TASK_PRIORITY Priority = TASK_PRIORITY_LOW, typename ... Fx>
+    void addDetachedTask(const xrCancellationToken& token, Fx ... args)
+    {
+        auto functor = std::bind(std::forward<Fx>(args)...);
+        auto task = xrTaskInline<decltype(functor)>::create(functor, Priority);
+        task->setCancellation(token);
+        push(task);
+    }
+
     void dispatch()
     {
         auto callerThread = std::this_thread::get_id();
         R_ASSERT(callerThread == d_thread_id);        
 
-        d_lock.Enter();
-        d_queued = std::move(d_queue);        
-        d_lock.Leave();
-
-        d_queue_size = d_queued.size();
+        // Tasks queued while dispatching wait for the next call. A task waiting
+        // on a worker thread may re-enter dispatch().
+        for (size_t count = d_queue.size(); count != 0; count--)
+        {
+            auto task = d_queue.pop();
+            if (!task)
+                break;
 
-        while (!d_queued.empty())
-        {            
-            d_queued.front()->invoke();
-            d_queued.pop_front();
-            --d_queue_size;
-        }     
+            task->execute();
+        }
     }
 
-    static xrTaskDispatcher* getCurrentThreadDispatcher()
-    {
-        auto thread = std::this_thread::get_id();
-        return d_dispatchersMap[thread];
-    }
+#if defined(__cpp_impl_coroutine)
+    // co_await dispatcher.schedule() continues the coroutine in this dispatcher's dispatch()
+    xrTaskScheduleAwaiter<xrTaskDispatcher> schedule();
+#endif
+
+    static xrTaskDispatcher* getCurrentThreadDispatcher();
 
     static xrTaskDispatcher* getThreadDispatcher(const std::thread::id& thread_id)
     {        
-        return d_dispatchersMap[thread_id];
+        return d_dispatchers.find(thread_id);
     }
 
 private:
     void push(const xrTaskShared& task)
     {
-        ScopedLock(d_lock);
+        task->d_owner = task;
+        push(task.get());
+    }
 
-        if (task->getPriority() == TASK_PRIORITY_LOW)
-            d_queue.push_back(task);
-        else
-            d_queue.push_front(task);
+    void push(xrTask* task)
+    {
+        task->submitted(d_queue);
+        d_queue.push(task);
 
-        d_queue_size++;
+        if (d_wakeup)
+            d_wakeup();
     }
 
     size_t totalQueued() const
     {
-        return d_queue_size;
+        return d_queue.size();
     }
 
-    using DispatcherThreadMap = std::map<std::thread::id, xrTaskDispatcher*>;        
-    static DispatcherThreadMap d_dispatchersMap;
+    using DispatcherRegistry = xrThreadRegistry<xrTaskDispatcher>;
+    static DispatcherRegistry d_dispatchers;
 
-    using SharedTaskQueue = std::deque<std::shared_ptr<xrTask>>;
-    
     // Tasks that will be dispatched
-    SharedTaskQueue d_queue;
+    xrTaskPriorityQueue d_queue;
 
-    // Tasks that will aready dispatched
-    SharedTaskQueue d_queued;
-           
-    xrFastLock d_lock;
     std::thread::id d_thread_id;
 
-    size_t d_queue_size = 0;
+    // Wakes the owner thread if it is parked, set by xrAsyncTaskDispatcher for its workers
+    xrDelegate<void()> d_wakeup;
 };
 
-#include "xrTask_inline.h"
\ No newline at end of file
+#include "xrTask_inline.h"
+#include "xrTaskCoroutine.h"
\ No newline at end of file
@@ -0,0 +1,187 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "xrAsyncTaskDispatcher.h"
+
+/**
+ * \brief Dependency graph of tasks executed on xrAsyncTaskDispatcher. A task starts once all
+ * of its predecessors are finished; the last finishing predecessor queues it, so no thread
+ * blocks on an edge. A graph is built once and may be submitted again after it completed.
+ */
+class xrTaskGraph
+{
+public:
+    using Node = size_t;
+
+    xrTaskGraph() = default;
+
+    ~xrTaskGraph()
+    {
+        wait();
+    }
+
+    xrTaskGraph(const xrTaskGraph& other) = delete;
+    xrTaskGraph(xrTaskGraph&& other) = delete;
+    xrTaskGraph& operator=(const xrTaskGraph& other) = delete;
+    xrTaskGraph& operator=(xrTaskGraph&& other) = delete;
+
+    template<TASK_PRIORITY Priority = TASK_PRIORITY_LOW, typename ... Fx>
+    Node addTask(Fx ... args)
+    {
+        R_ASSERT(ready());
+
+        auto functor = std::bind(std::forward<Fx>(args)...);
+        d_nodes.push_back(std::make_unique<GraphTask>(*this, xrDelegate<void()>(functor), Priority));
+        return d_nodes.size() - 1;
+    }
+
+    // task starts only after predecessor has finished
+    void addDependency(Node task, Node predecessor)
+    {
+        R_ASSERT(ready());
+        R_ASSERT(task < d_nodes.size() && predecessor < d_nodes.size() && task != predecessor);
+
+        d_nodes[predecessor]->d_successors.push_back(d_nodes[task].get());
+        d_nodes[task]->d_predecessors++;
+    }
+
+    // Queues every task without predecessors, the rest is triggered as the graph runs
+    void submit()
+    {
+        R_ASSERT(ready());
+
+        if (d_nodes.empty())
+            return;
+
+        // A cycle would never complete, and wait() would block forever
+        R_ASSERT(acyclic());
+
+        d_done.reset();
+        d_remaining.store(d_nodes.size(), std::memory_order_relaxed);
+
+        std::vector<GraphTask*> roots;
+        for (auto& node : d_nodes)
+        {
+            node->reset();
+            node->d_pending.store(node->d_predecessors, std::memory_order_relaxed);
+
+            if (node->d_predecessors == 0)
+                roots.push_back(node.get());
+        }
+
+        auto dispatcher = xrAsyncTaskDispatcher::g_async_task_dispatcher.get();
+        for (auto root : roots)
+            dispatcher->push(root);
+    }
+
+    void wait() const
+    {
+        d_done.wait();
+    }
+
+    // True when the graph is not running: not submitted yet or all tasks finished
+    bool ready() const
+    {
+        return d_done.ready();
+    }
+
+    bool ready(Node task) const
+    {
+        return d_nodes[task]->ready();
+    }
+
+    size_t size() const
+    {
+        return d_nodes.size();
+    }
+
+private:
+    class GraphTask;
+
+    // Kahn's algorithm, run on d_pending while the graph is not running: a task on a cycle or
+    // behind one is never reached from the roots
+    bool acyclic() const
+    {
+        std::vector<GraphTask*> reachable;
+        for (auto& node : d_nodes)
+        {
+            node->d_pending.store(node->d_predecessors, std::memory_order_relaxed);
+            if (node->d_predecessors == 0)
+                reachable.push_back(node.get());
+        }
+
+        size_t reached = 0;
+        while (!reachable.empty())
+        {
+            auto node = reachable.back();
+            reachable.pop_back();
+            reached++;
+
+            for (auto successor : node->d_successors)
+            {
+                if (successor->d_pending.fetch_sub(1, std::memory_order_relaxed) == 1)
+                    reachable.push_back(successor);
+            }
+        }
+
+        return reached == d_nodes.size();
+    }
+
+    class GraphTask : public xrTask
+    {
+        friend class xrTaskGraph;
+
+    public:
+        GraphTask(xrTaskGraph& graph, const xrDelegate<void()>& function, TASK_PRIORITY priority)
+            : xrTask(priority), d_graph(graph), d_function(function) {}
+
+    protected:
+        void invoke() override
+        {
+            if (!start())
+                return;
+
+            d_function();
+
+            auto dispatcher = xrAsyncTaskDispatcher::g_async_task_dispatcher.get();
+            for (auto successor : d_successors)
+            {
+                if (successor->d_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    dispatcher->push(successor);
+            }
+
+            auto& graph = d_graph;
+            finish();
+
+            // Last touch of the graph, a waiter may resubmit or destroy it right after
+            if (graph.d_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                graph.d_done.finish();
+        }
+
+    private:
+        xrTaskGraph& d_graph;
+        xrDelegate<void()> d_function;
+        std::vector<GraphTask*> d_successors;
+        size_t d_predecessors = 0;
+        std::atomic<size_t> d_pending { 0 };
+    };
+
+    // Becomes ready when the last task of a submitted graph finishes
+    class Completion : public xrTask
+    {
+        friend class xrTaskGraph;
+
+    public:
+        Completion() : xrTask(TASK_PRIORITY_LOW)
+        {
+            finish();
+        }
+
+    protected:
+        void invoke() override {}
+    };
+
+    std::vector<std::unique_ptr<GraphTask>> d_nodes;
+    std::atomic<size_t> d_remaining { 0 };
+    Completion d_done;
+};
@@ -0,0 +1,131 @@
+#pragma once
+#include <iterator>
+#include <memory>
+#include <vector>
+#include "xrTaskDispatcher.h"
+
+/**
+ * \brief Task that is ready once a number of other tasks are done. Every joined task reports
+ * to one shared counter when it completes, so waiting on a batch is a single wait instead of
+ * one per task. Created by when_all() and when_any().
+ */
+class xrTaskJoin : public xrTask
+{
+public:
+    xrTaskJoin(size_t count, size_t required) : xrTask(TASK_PRIORITY_NORMAL), d_arrivals(count), d_required(required) {}
+
+    template<typename Iterator>
+    static std::shared_ptr<xrTaskJoin> create(Iterator first, Iterator last, bool any)
+    {
+        auto count = static_cast<size_t>(std::distance(first, last));
+        auto join = std::allocate_shared<xrTaskJoin>(xrTaskAllocator<xrTaskJoin>(), count, any ? 1 : count);
+
+        if (count == 0)
+        {
+            join->start();
+            join->finish();
+            return join;
+        }
+
+        // Joined tasks point into the join, it stays alive until the last of them reported
+        join->d_self = join;
+
+        size_t index = 0;
+        for (; first != last; ++first, ++index)
+        {
+            auto& arrival = join->d_arrivals[index];
+            arrival.d_join = join.get();
+            arrival.d_index = index;
+
+            xrTask& task = **first;
+            if (!task.addContinuation(&arrival))
+                arrival.run();
+        }
+
+        return join;
+    }
+
+    // Position of the first task that completed, in the order the tasks were passed
+    size_t get() const
+    {
+        R_ASSERT(done());
+        return d_first;
+    }
+
+    size_t size() const
+    {
+        return d_arrivals.size();
+    }
+
+protected:
+    // Never queued, completed by the last required arrival
+    void invoke() override {}
+
+private:
+    struct Arrival : xrTaskContinuation
+    {
+        void run() override
+        {
+            d_join->arrive(d_index);
+        }
+
+        xrTaskJoin* d_join = nullptr;
+        size_t d_index = 0;
+    };
+
+    void arrive(size_t index)
+    {
+        auto arrived = d_arrived.fetch_add(1, std::memory_order_acq_rel) + 1;
+
+        if (arrived == 1)
+            d_first = index;
+
+        if (arrived == d_required && start())
+            finish();
+
+        // May destroy the join, nothing of it is touched afterwards
+        if (arrived == d_arrivals.size())
+            d_self.reset();
+    }
+
+    std::vector<Arrival> d_arrivals;
+    const size_t d_required;
+    std::atomic<size_t> d_arrived { 0 };
+    size_t d_first = 0;
+    xrTaskShared d_self;
+};
+
+// Ready once every task of the container is done
+template<typename Container>
+std::shared_ptr<xrTaskJoin> when_all(const Container& tasks)
+{
+    return xrTaskJoin::create(std::begin(tasks), std::end(tasks), false);
+}
+
+template<typename ... Tasks>
+std::shared_ptr<xrTaskJoin> when_all(const std::shared_ptr<Tasks>& ... tasks)
+{
+    xrTask* list[] = { tasks.get() ... };
+    return when_all(list);
+}
+
+// Ready once any task of the container is done, get() tells which one
+template<typename Container>
+std::shared_ptr<xrTaskJoin> when_any(const Container& tasks)
+{
+    return xrTaskJoin::create(std::begin(tasks), std::end(tasks), true);
+}
+
+template<typename ... Tasks>
+std::shared_ptr<xrTaskJoin> when_any(const std::shared_ptr<Tasks>& ... tasks)
+{
+    xrTask* list[] = { tasks.get() ... };
+    return when_any(list);
+}
+
+#if defined(__cpp_impl_coroutine)
+inline xrTaskResultAwaiter<xrTaskJoin> operator co_await(const std::shared_ptr<xrTaskJoin>& join)
+{
+    return xrTaskResultAwaiter<xrTaskJoin>(join);
+}
+#endif
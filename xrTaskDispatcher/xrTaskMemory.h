@@ -0,0 +1,162 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+/**
+ * \brief Size-class freelists for task objects. Every thread keeps a private cache, blocks
+ * move between threads in batches through a central list: tasks are usually allocated by a
+ * submitting thread and released by a worker. Memory is reused, never returned to the system.
+ */
+class XRCORE_API xrTaskMemory
+{
+public:
+    static constexpr size_t granularity = 64;
+    static constexpr size_t class_count = 8;
+    static constexpr size_t batch_size = 64;
+    static constexpr size_t max_cached = 2 * batch_size;
+
+    static void* allocate(size_t size)
+    {
+        size_t index = sizeClass(size);
+        if (index >= class_count)
+            return ::operator new(size);
+
+        auto& list = cache().d_lists[index];
+        if (list.d_count == 0)
+            refill(index, list);
+
+        if (auto block = list.pop())
+            return block;
+
+        return ::operator new((index + 1) * granularity);
+    }
+
+    static void deallocate(void* memory, size_t size)
+    {
+        size_t index = sizeClass(size);
+        if (index >= class_count)
+        {
+            ::operator delete(memory);
+            return;
+        }
+
+        auto& list = cache().d_lists[index];
+        list.push(static_cast<Block*>(memory));
+
+        if (list.d_count > max_cached)
+            spill(index, list, batch_size);
+    }
+
+private:
+    struct Block
+    {
+        Block* d_next;
+    };
+
+    struct List
+    {
+        void push(Block* block)
+        {
+            block->d_next = d_head;
+            d_head = block;
+            d_count++;
+        }
+
+        Block* pop()
+        {
+            auto block = d_head;
+            if (block)
+            {
+                d_head = block->d_next;
+                d_count--;
+            }
+            return block;
+        }
+
+        Block* d_head = nullptr;
+        size_t d_count = 0;
+    };
+
+    struct Cache
+    {
+        // A finished thread hands its blocks over to the threads still running
+        ~Cache()
+        {
+            for (size_t index = 0; index < class_count; index++)
+                spill(index, d_lists[index], d_lists[index].d_count);
+        }
+
+        List d_lists[class_count];
+    };
+
+    struct Central
+    {
+        std::mutex d_lock;
+        List d_lists[class_count];
+    };
+
+    static size_t sizeClass(size_t size)
+    {
+        return size != 0 ? (size - 1) / granularity : 0;
+    }
+
+    static void refill(size_t index, List& list)
+    {
+        std::lock_guard<std::mutex> lock(d_central.d_lock);
+        auto& central = d_central.d_lists[index];
+        for (size_t count = 0; count < batch_size && central.d_count != 0; count++)
+            list.push(central.pop());
+    }
+
+    static void spill(size_t index, List& list, size_t count)
+    {
+        std::lock_guard<std::mutex> lock(d_central.d_lock);
+        auto& central = d_central.d_lists[index];
+        for (; count != 0 && list.d_count != 0; count--)
+            central.push(list.pop());
+    }
+
+    static Cache& cache()
+    {
+        thread_local Cache cache;
+        return cache;
+    }
+
+    static Central d_central;
+};
+
+// Standard allocator over xrTaskMemory, used with std::allocate_shared for task objects
+template<typename T>
+struct xrTaskAllocator
+{
+    using value_type = T;
+
+    xrTaskAllocator() = default;
+
+    template<typename U>
+    xrTaskAllocator(const xrTaskAllocator<U>&) noexcept {}
+
+    T* allocate(size_t count)
+    {
+        static_assert(alignof(T) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "over-aligned task types are not supported");
+        return static_cast<T*>(xrTaskMemory::allocate(count * sizeof(T)));
+    }
+
+    void deallocate(T* memory, size_t count) noexcept
+    {
+        xrTaskMemory::deallocate(memory, count * sizeof(T));
+    }
+
+    template<typename U>
+    bool operator==(const xrTaskAllocator<U>&) const noexcept
+    {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const xrTaskAllocator<U>&) const noexcept
+    {
+        return false;
+    }
+};
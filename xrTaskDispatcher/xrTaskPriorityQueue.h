@@ -0,0 +1,268 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <iterator>
+#include "xrTask.h"
+#include "../xrPlatform/xrLock.h"
+
+// Collapses all priority levels into one FIFO queue
+constexpr bool g_disableTaskPriority = false;
+
+/**
+ * \brief Multi-producer / multi-consumer task queue with a FIFO per TASK_PRIORITY level,
+ * higher levels are served first. Every aging_interval pops the oldest queued task is taken
+ * regardless of its level, so lower levels keep moving under a steady stream of urgent work.
+ * Deadlines are checked when a task reaches the front.
+ *
+ * Producers never take a lock: tasks are published into a bounded ring (Vyukov) and only
+ * spill into a locked overflow list when the ring is full. Consumers serialize on d_lock and
+ * move published tasks into the priority levels before selecting one.
+ */
+class xrTaskPriorityQueue
+{
+public:
+    static constexpr size_t aging_interval = 8;
+    static constexpr size_t ring_size = 256;
+
+    xrTaskPriorityQueue()
+    {
+        for (size_t index = 0; index < ring_size; index++)
+            d_ring[index].d_sequence.store(index, std::memory_order_relaxed);
+    }
+
+    ~xrTaskPriorityQueue()
+    {
+        clear();
+    }
+
+    xrTaskPriorityQueue(const xrTaskPriorityQueue& other) = delete;
+    xrTaskPriorityQueue(xrTaskPriorityQueue&& other) = delete;
+    xrTaskPriorityQueue& operator=(const xrTaskPriorityQueue& other) = delete;
+    xrTaskPriorityQueue& operator=(xrTaskPriorityQueue&& other) = delete;
+
+    void push(xrTask* task)
+    {
+        // Counted before publishing, so a consumer never sees more tasks than the size
+        d_size.fetch_add(1, std::memory_order_relaxed);
+
+        if (publish(task))
+            return;
+
+        std::lock_guard<xrLock> lock(d_overflow_lock);
+        d_overflow.push_back(task);
+        d_overflow_size.fetch_add(1, std::memory_order_release);
+    }
+
+    // Takes the next task of at least min_priority, late tasks are deferred on the way
+    xrTask* pop(TASK_PRIORITY min_priority = TASK_PRIORITY_BACKGROUND)
+    {
+        if (d_size.load(std::memory_order_relaxed) == 0)
+            return nullptr;
+
+        std::lock_guard<xrLock> lock(d_lock);
+        collect();
+
+        while (true)
+        {
+            int selected = select(level(min_priority));
+            if (selected < 0)
+                return nullptr;
+
+            Entry entry = d_levels[selected].front();
+            d_levels[selected].pop_front();
+            d_size.fetch_sub(1, std::memory_order_relaxed);
+
+            auto task = entry.d_task;
+            task->d_taskQueue.store(nullptr, std::memory_order_relaxed);
+
+            // Late tasks with TASK_DEADLINE_DROP are returned and dropped by execute(), which
+            // may run continuations and must not do so under the queue lock
+            if (task->late() && task->d_deadlinePolicy.load(std::memory_order_relaxed) == TASK_DEADLINE_DEFER)
+            {
+                task->d_deadline.store(xrTask::no_deadline, std::memory_order_relaxed);
+                task->d_taskPriority = TASK_PRIORITY_BACKGROUND;
+                d_size.fetch_add(1, std::memory_order_relaxed);
+                insert({ task, d_sequence++ }, level(TASK_PRIORITY_BACKGROUND));
+                continue;
+            }
+
+            return task;
+        }
+    }
+
+    // Moves a still queued task to the level of its current priority, keeping its age
+    void update(xrTask* task)
+    {
+        std::lock_guard<xrLock> lock(d_lock);
+        collect();
+
+        if (task->d_taskQueue.load(std::memory_order_relaxed) != this)
+            return;
+
+        for (auto& queue : d_levels)
+        {
+            for (auto it = queue.begin(); it != queue.end(); ++it)
+            {
+                if (it->d_task != task)
+                    continue;
+
+                Entry entry = *it;
+                queue.erase(it);
+                insert(entry, level(task->getPriority()));
+                return;
+            }
+        }
+    }
+
+    // Releases every queued task without executing it
+    void clear()
+    {
+        std::lock_guard<xrLock> lock(d_lock);
+        collect();
+
+        for (auto& queue : d_levels)
+        {
+            for (auto& entry : queue)
+            {
+                entry.d_task->d_taskQueue.store(nullptr, std::memory_order_relaxed);
+                entry.d_task->discard();
+            }
+
+            d_size.fetch_sub(queue.size(), std::memory_order_relaxed);
+            queue.clear();
+        }
+    }
+
+    size_t size() const
+    {
+        return d_size.load(std::memory_order_relaxed);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+private:
+    struct Entry
+    {
+        xrTask* d_task;
+        uint64_t d_sequence;
+    };
+
+    static int level(TASK_PRIORITY priority)
+    {
+        return g_disableTaskPriority ? TASK_PRIORITY_NORMAL : priority;
+    }
+
+    // Entries of a level keep their push order, a task moved by update() is placed by its age
+    void insert(const Entry& entry, int level)
+    {
+        auto& queue = d_levels[level];
+        auto position = queue.end();
+        while (position != queue.begin() && std::prev(position)->d_sequence > entry.d_sequence)
+            --position;
+
+        queue.insert(position, entry);
+        entry.d_task->d_taskQueue.store(this, std::memory_order_relaxed);
+    }
+
+    bool publish(xrTask* task)
+    {
+        size_t position = d_enqueue.load(std::memory_order_relaxed);
+        while (true)
+        {
+            auto& cell = d_ring[position % ring_size];
+            size_t sequence = cell.d_sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+            if (difference == 0)
+            {
+                if (d_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    cell.d_task = task;
+                    cell.d_sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0)
+                return false;
+            else
+                position = d_enqueue.load(std::memory_order_relaxed);
+        }
+    }
+
+    // Moves published tasks into the priority levels, called by the consumer holding d_lock
+    void collect()
+    {
+        while (true)
+        {
+            auto& cell = d_ring[d_dequeue % ring_size];
+            if (cell.d_sequence.load(std::memory_order_acquire) != d_dequeue + 1)
+                break;
+
+            auto task = cell.d_task;
+            cell.d_sequence.store(d_dequeue + ring_size, std::memory_order_release);
+            d_dequeue++;
+
+            insert({ task, d_sequence++ }, level(task->getPriority()));
+        }
+
+        if (d_overflow_size.load(std::memory_order_acquire) == 0)
+            return;
+
+        std::lock_guard<xrLock> lock(d_overflow_lock);
+        for (auto task : d_overflow)
+            insert({ task, d_sequence++ }, level(task->getPriority()));
+
+        d_overflow.clear();
+        d_overflow_size.store(0, std::memory_order_relaxed);
+    }
+
+    int select(int min_level)
+    {
+        int selected = -1;
+
+        if (++d_pops % aging_interval == 0)
+        {
+            for (int index = TASK_PRIORITY_COUNT - 1; index >= min_level; index--)
+            {
+                if (!d_levels[index].empty() && (selected < 0 ||
+                    d_levels[index].front().d_sequence < d_levels[selected].front().d_sequence))
+                    selected = index;
+            }
+            return selected;
+        }
+
+        for (int index = TASK_PRIORITY_COUNT - 1; index >= min_level; index--)
+        {
+            if (!d_levels[index].empty())
+                return index;
+        }
+
+        return selected;
+    }
+
+    struct Cell
+    {
+        std::atomic<size_t> d_sequence;
+        xrTask* d_task = nullptr;
+    };
+
+    // Producer side
+    Cell d_ring[ring_size];
+    alignas(64) std::atomic<size_t> d_enqueue { 0 };
+    std::deque<xrTask*> d_overflow;
+    std::atomic<size_t> d_overflow_size { 0 };
+    xrLock d_overflow_lock;
+
+    // Consumer side, guarded by d_lock
+    alignas(64) size_t d_dequeue = 0;
+    std::deque<Entry> d_levels[TASK_PRIORITY_COUNT];
+    uint64_t d_sequence = 0;
+    size_t d_pops = 0;
+    xrLock d_lock;
+
+    // Published and not yet popped
+    std::atomic<size_t> d_size { 0 };
+};
@@ -0,0 +1,312 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Set to 1 to record task spans and counters. At 0 every hook is an empty inline function, so
+// the hooks may stay in release builds. Class layouts do not depend on it, but it is still a
+// project-wide setting: every translation unit of the library and its users must agree.
+#ifndef XR_TASK_PROFILING
+#define XR_TASK_PROFILING 0
+#endif
+
+enum TASK_SPAN
+{
+    TASK_SPAN_RUN,      // a task executing
+    TASK_SPAN_IDLE      // a worker parked with nothing to do
+};
+
+struct xrTaskCounters
+{
+    uint64_t submitted = 0;
+    uint64_t executed = 0;
+    uint64_t dropped = 0;           // cancelled or expired instead of executed
+    uint64_t stolen = 0;
+    uint64_t parked = 0;
+    uint64_t run_time_ns = 0;
+    uint64_t latency_ns = 0;        // submit to start, summed over executed tasks
+    uint64_t idle_ns = 0;
+    uint64_t max_queue_depth = 0;   // deepest queue a task was submitted to
+};
+
+// Counters of one thread, e.g. one xrAsyncTaskDispatcher worker
+struct xrTaskThreadCounters
+{
+    std::string name;
+    xrTaskCounters counters;
+};
+
+/**
+ * \brief Task system instrumentation. Every thread records into its own ring of spans and its own
+ * counters, written without locks or shared cache lines; readers aggregate on demand. Rings keep
+ * the latest ring_size spans per thread and outlive their threads so a trace can be taken later.
+ */
+class XRCORE_API xrTaskProfiler
+{
+public:
+    static constexpr bool enabled = XR_TASK_PROFILING != 0;
+    static constexpr size_t ring_size = 4096;
+
+    // Nanoseconds of steady_clock, 0 when profiling is disabled
+    static int64_t now()
+    {
+        if constexpr (enabled)
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        else
+            return 0;
+    }
+
+    static void submitted(size_t queue_depth)
+    {
+        if constexpr (enabled)
+        {
+            auto& counters = thread().d_counters;
+            add(counters.d_submitted, 1);
+            if (queue_depth > counters.d_max_queue_depth.load(std::memory_order_relaxed))
+                counters.d_max_queue_depth.store(queue_depth, std::memory_order_relaxed);
+        }
+    }
+
+    static void executed(const char* label, int64_t submit_time, int64_t begin, int64_t end)
+    {
+        if constexpr (enabled)
+        {
+            auto& counters = thread().d_counters;
+            add(counters.d_executed, 1);
+            add(counters.d_run_time_ns, end - begin);
+            if (submit_time != 0 && begin > submit_time)
+                add(counters.d_latency_ns, begin - submit_time);
+            record(TASK_SPAN_RUN, label, begin, end);
+        }
+    }
+
+    static void dropped()
+    {
+        if constexpr (enabled)
+            add(thread().d_counters.d_dropped, 1);
+    }
+
+    static void stolen()
+    {
+        if constexpr (enabled)
+            add(thread().d_counters.d_stolen, 1);
+    }
+
+    static void idle(int64_t begin, int64_t end)
+    {
+        if constexpr (enabled)
+        {
+            auto& counters = thread().d_counters;
+            add(counters.d_parked, 1);
+            add(counters.d_idle_ns, end - begin);
+            record(TASK_SPAN_IDLE, "idle", begin, end);
+        }
+    }
+
+    // Names the calling thread in exported traces and per-thread counters
+    static void setThreadName(const char* name)
+    {
+        if constexpr (enabled)
+        {
+            auto& current = thread();
+            std::lock_guard<std::mutex> lock(d_lock);
+            current.d_name = name;
+        }
+    }
+
+    // Sum over every thread that recorded anything
+    static xrTaskCounters counters()
+    {
+        xrTaskCounters result;
+        for (auto& thread : threadCounters())
+        {
+            auto& counters = thread.counters;
+            result.submitted += counters.submitted;
+            result.executed += counters.executed;
+            result.dropped += counters.dropped;
+            result.stolen += counters.stolen;
+            result.parked += counters.parked;
+            result.run_time_ns += counters.run_time_ns;
+            result.latency_ns += counters.latency_ns;
+            result.idle_ns += counters.idle_ns;
+            result.max_queue_depth = std::max(result.max_queue_depth, counters.max_queue_depth);
+        }
+        return result;
+    }
+
+    // Counters of every thread that recorded anything, in the order the threads first did
+    static std::vector<xrTaskThreadCounters> threadCounters()
+    {
+        std::vector<xrTaskThreadCounters> result;
+        if constexpr (enabled)
+        {
+            std::lock_guard<std::mutex> lock(d_lock);
+            result.reserve(d_threads.size());
+            for (auto thread : d_threads)
+            {
+                auto& counters = thread->d_counters;
+                auto& entry = result.emplace_back();
+                entry.name = thread->d_name;
+                entry.counters.submitted = counters.d_submitted.load(std::memory_order_relaxed);
+                entry.counters.executed = counters.d_executed.load(std::memory_order_relaxed);
+                entry.counters.dropped = counters.d_dropped.load(std::memory_order_relaxed);
+                entry.counters.stolen = counters.d_stolen.load(std::memory_order_relaxed);
+                entry.counters.parked = counters.d_parked.load(std::memory_order_relaxed);
+                entry.counters.run_time_ns = counters.d_run_time_ns.load(std::memory_order_relaxed);
+                entry.counters.latency_ns = counters.d_latency_ns.load(std::memory_order_relaxed);
+                entry.counters.idle_ns = counters.d_idle_ns.load(std::memory_order_relaxed);
+                entry.counters.max_queue_depth = counters.d_max_queue_depth.load(std::memory_order_relaxed);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * \brief Spans currently held by the rings as Chrome trace event JSON, loadable in
+     * chrome://tracing and Perfetto. May be called while tasks are running; spans overwritten
+     * during the export are left out.
+     */
+    static std::string chromeTrace()
+    {
+        std::string json = "{\"traceEvents\":[";
+        if constexpr (enabled)
+        {
+            std::lock_guard<std::mutex> lock(d_lock);
+            bool first = true;
+            char buffer[128];
+
+            for (size_t index = 0; index < d_threads.size(); index++)
+            {
+                auto thread = d_threads[index];
+
+                json += first ? "" : ",";
+                first = false;
+                snprintf(buffer, sizeof(buffer), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"", index);
+                json += buffer;
+                escape(json, thread->d_name.empty() ? "thread" : thread->d_name.c_str());
+                json += "\"}}";
+
+                uint64_t head = thread->d_head.load(std::memory_order_acquire);
+                uint64_t position = head > ring_size ? head - ring_size : 0;
+
+                for (; position < head; position++)
+                {
+                    auto& span = thread->d_spans[position % ring_size];
+                    auto type = span.d_type.load(std::memory_order_relaxed);
+                    auto label = span.d_label.load(std::memory_order_relaxed);
+                    auto begin = span.d_begin.load(std::memory_order_relaxed);
+                    auto end = span.d_end.load(std::memory_order_relaxed);
+
+                    // The owner may have lapped the reader and rewritten the slot meanwhile
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (thread->d_head.load(std::memory_order_relaxed) - position >= ring_size)
+                        continue;
+
+                    json += ",{\"name\":\"";
+                    escape(json, label ? label : "task");
+                    snprintf(buffer, sizeof(buffer), "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%zu}",
+                        type == TASK_SPAN_IDLE ? "idle" : "task", begin / 1000.0, (end - begin) / 1000.0, index);
+                    json += buffer;
+                }
+            }
+        }
+        json += "]}";
+        return json;
+    }
+
+    static bool saveChromeTrace(const char* path)
+    {
+        auto file = fopen(path, "wb");
+        if (!file)
+            return false;
+
+        auto json = chromeTrace();
+        bool written = fwrite(json.data(), 1, json.size(), file) == json.size();
+        return fclose(file) == 0 && written;
+    }
+
+private:
+    struct Span
+    {
+        std::atomic<u8> d_type { TASK_SPAN_RUN };
+        std::atomic<const char*> d_label { nullptr };
+        std::atomic<int64_t> d_begin { 0 };
+        std::atomic<int64_t> d_end { 0 };
+    };
+
+    // Written by the owning thread only, read by counters()
+    struct Counters
+    {
+        std::atomic<uint64_t> d_submitted { 0 };
+        std::atomic<uint64_t> d_executed { 0 };
+        std::atomic<uint64_t> d_dropped { 0 };
+        std::atomic<uint64_t> d_stolen { 0 };
+        std::atomic<uint64_t> d_parked { 0 };
+        std::atomic<uint64_t> d_run_time_ns { 0 };
+        std::atomic<uint64_t> d_latency_ns { 0 };
+        std::atomic<uint64_t> d_idle_ns { 0 };
+        std::atomic<uint64_t> d_max_queue_depth { 0 };
+    };
+
+    struct Thread
+    {
+        Span d_spans[ring_size];
+        std::atomic<uint64_t> d_head { 0 };
+        Counters d_counters;
+        std::string d_name;
+    };
+
+    static void add(std::atomic<uint64_t>& counter, uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    static void record(TASK_SPAN type, const char* label, int64_t begin, int64_t end)
+    {
+        auto& current = thread();
+        uint64_t head = current.d_head.load(std::memory_order_relaxed);
+        auto& span = current.d_spans[head % ring_size];
+
+        // Pairs with the fence in chromeTrace(): a reader seeing any of the new values also sees
+        // the head that marks the slot as being rewritten
+        std::atomic_thread_fence(std::memory_order_release);
+        span.d_type.store(static_cast<u8>(type), std::memory_order_relaxed);
+        span.d_label.store(label, std::memory_order_relaxed);
+        span.d_begin.store(begin, std::memory_order_relaxed);
+        span.d_end.store(end, std::memory_order_relaxed);
+        current.d_head.store(head + 1, std::memory_order_release);
+    }
+
+    static void escape(std::string& json, const char* text)
+    {
+        for (; *text; text++)
+        {
+            if (*text == '"' || *text == '\\')
+                json += '\\';
+            if (static_cast<unsigned char>(*text) >= 0x20)
+                json += *text;
+        }
+    }
+
+    static Thread& thread()
+    {
+        thread_local Thread* current = attach();
+        return *current;
+    }
+
+    static Thread* attach()
+    {
+        auto thread = new Thread();
+        std::lock_guard<std::mutex> lock(d_lock);
+        d_threads.push_back(thread);
+        return thread;
+    }
+
+    static std::mutex d_lock;
+    static std::vector<Thread*> d_threads;
+};
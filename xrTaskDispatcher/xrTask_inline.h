@@ -1,5 +1,14 @@
 ﻿#pragma once
 #include "xrTask.h"
+#include "xrTaskPriorityQueue.h"
+
+inline void xrTask::setPriority(TASK_PRIORITY priority)
+{
+    d_taskPriority = priority;
+
+    if (auto queue = d_taskQueue.load(std::memory_order_acquire))
+        queue->update(this);
+}
 
 template <typename Functor, typename TResult>
 xrTaskFunction<Functor, TResult>::xrTaskFunction(Functor& functor, TASK_PRIORITY priority)
@@ -13,50 +22,59 @@ template <typename Functor, typename TResult>
 template <typename ... Fx>
 void xrTaskFunction<Functor, TResult>::then(Fx&&... callback)
 {
-    ScopedLock(d_lock);    
-    R_ASSERT(d_callback == nullptr);
+    // The callback holds the task, so the result is read in place instead of being copied
+    auto source = this->shared_from_this();
 
     if constexpr (std::is_same_v<TResult, void>)
     {
-        d_callback = std::bind(std::forward<Fx>(callback) ...);
-        
-        if (ready())
-            d_callback();
+        auto functor = [source, callback = std::bind(std::forward<Fx>(callback) ...)]() mutable
+        {
+            if (source->ready())
+                callback();
+        };
+        addCallback(functor);
     }
     else
     {
-        d_callback = std::bind(std::forward<Fx>(callback) ..., std::placeholders::_1);
-        
-        if (ready())
-            d_callback(d_result);
+        auto functor = [source, callback = std::bind(std::forward<Fx>(callback) ..., std::placeholders::_1)]() mutable
+        {
+            if (source->ready())
+                callback(source->get());
+        };
+        addCallback(functor);
     }
 }
 
+template <typename Functor, typename TResult>
+template <typename Callback>
+void xrTaskFunction<Functor, TResult>::addCallback(Callback& callback)
+{
+    auto continuation = xrTaskCallback<Callback>::create(callback, getPriority(), d_dispatcher);
+
+    // Already completed: run on the calling thread, like a then() on a ready task always did
+    if (!addContinuation(continuation))
+        continuation->invoke();
+}
+
 template <typename Functor, typename TResult>
 void xrTaskFunction<Functor, TResult>::invoke()
 {    
-    d_taskState = STATE_WORKING;
+    if (!start())
+        return;
 
     if constexpr (std::is_same_v<TResult, void>)
-    {
         d_functor();
-            
-        if (d_callback)
-        {
-			ScopedLock(d_lock);
-			d_dispatcher->addTask(d_callback);
-        }
-    }
     else
-    {
         d_result = d_functor();
-              
-        if (d_callback)
-        {
-			ScopedLock(d_lock);
-			d_dispatcher->addTask(d_callback, d_result);
-        }                
-    }
 
-    d_taskState = STATE_READY;
+    finish();
+}
+
+template <typename Functor>
+void xrTaskCallback<Functor>::run()
+{
+    if (d_dispatcher)
+        d_dispatcher->push(static_cast<xrTask*>(this));
+    else
+        invoke();
 }
@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/**
+ * \brief Fixed capacity open addressing map from thread id to T*. find() never locks and is
+ * safe against concurrent insert() / erase(), writers are serialized by a mutex. Slots of
+ * erased entries are reused by later threads, so probe chains are never broken.
+ */
+template<typename T, size_t Capacity = 1024>
+class xrThreadRegistry
+{
+public:
+    xrThreadRegistry() = default;
+    xrThreadRegistry(const xrThreadRegistry& other) = delete;
+    xrThreadRegistry& operator=(const xrThreadRegistry& other) = delete;
+
+    void insert(std::thread::id thread, T* value)
+    {
+        std::lock_guard<std::mutex> lock(d_lock);
+
+        Slot* reusable = nullptr;
+        size_t start = slotIndex(thread);
+        for (size_t probe = 0; probe < Capacity; probe++)
+        {
+            auto& slot = d_slots[(start + probe) % Capacity];
+            auto current = slot.d_thread.load(std::memory_order_relaxed);
+
+            if (current == thread)
+            {
+                slot.d_value.store(value, std::memory_order_release);
+                return;
+            }
+
+            if (current == std::thread::id())
+            {
+                if (!reusable)
+                    reusable = &slot;
+                break;
+            }
+
+            if (!reusable && slot.d_value.load(std::memory_order_relaxed) == nullptr)
+                reusable = &slot;
+        }
+
+        R_ASSERT(reusable);
+        reusable->d_thread.store(thread, std::memory_order_release);
+        reusable->d_value.store(value, std::memory_order_release);
+    }
+
+    // Removes the entry only if it still maps to value
+    void erase(std::thread::id thread, T* value)
+    {
+        std::lock_guard<std::mutex> lock(d_lock);
+
+        if (auto slot = findSlot(thread))
+        {
+            if (slot->d_value.load(std::memory_order_relaxed) == value)
+                slot->d_value.store(nullptr, std::memory_order_release);
+        }
+    }
+
+    T* find(std::thread::id thread) const
+    {
+        if (auto slot = findSlot(thread))
+        {
+            auto value = slot->d_value.load(std::memory_order_acquire);
+
+            // The slot may have been handed to another thread meanwhile
+            if (slot->d_thread.load(std::memory_order_acquire) == thread)
+                return value;
+        }
+
+        return nullptr;
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<std::thread::id> d_thread {};
+        std::atomic<T*> d_value { nullptr };
+    };
+
+    static size_t slotIndex(std::thread::id thread)
+    {
+        return std::hash<std::thread::id>()(thread) % Capacity;
+    }
+
+    Slot* findSlot(std::thread::id thread) const
+    {
+        size_t start = slotIndex(thread);
+        for (size_t probe = 0; probe < Capacity; probe++)
+        {
+            auto& slot = d_slots[(start + probe) % Capacity];
+            auto current = slot.d_thread.load(std::memory_order_acquire);
+
+            if (current == thread)
+                return const_cast<Slot*>(&slot);
+
+            if (current == std::thread::id())
+                return nullptr;
+        }
+
+        return nullptr;
+    }
+
+    Slot d_slots[Capacity];
+    std::mutex d_lock;
+};
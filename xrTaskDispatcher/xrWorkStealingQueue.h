@@ -0,0 +1,143 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \brief Chase-Lev work-stealing deque. The owner thread pushes and pops at the bottom (LIFO),
+ * any other thread may steal from the top (FIFO). The ring grows on demand; replaced rings are
+ * kept until the deque is destroyed because a thief may still be reading them.
+ */
+template<typename T>
+class xrWorkStealingQueue
+{
+public:
+    explicit xrWorkStealingQueue(int64_t capacity = 256)
+    {
+        d_array.store(new Array(capacity), std::memory_order_relaxed);
+    }
+
+    ~xrWorkStealingQueue()
+    {
+        delete d_array.load(std::memory_order_relaxed);
+        for (auto array : d_retired)
+            delete array;
+    }
+
+    xrWorkStealingQueue(const xrWorkStealingQueue& other) = delete;
+    xrWorkStealingQueue(xrWorkStealingQueue&& other) = delete;
+    xrWorkStealingQueue& operator=(const xrWorkStealingQueue& other) = delete;
+    xrWorkStealingQueue& operator=(xrWorkStealingQueue&& other) = delete;
+
+    // Owner thread only
+    void push(T* item)
+    {
+        int64_t bottom = d_bottom.load(std::memory_order_relaxed);
+        int64_t top = d_top.load(std::memory_order_acquire);
+        Array* array = d_array.load(std::memory_order_relaxed);
+
+        if (bottom - top > array->capacity - 1)
+        {
+            d_retired.push_back(array);
+            array = array->grow(bottom, top);
+            d_array.store(array, std::memory_order_release);
+        }
+
+        array->put(bottom, item);
+        d_bottom.store(bottom + 1, std::memory_order_release);
+    }
+
+    // Owner thread only
+    T* pop()
+    {
+        int64_t bottom = d_bottom.load(std::memory_order_relaxed) - 1;
+        Array* array = d_array.load(std::memory_order_relaxed);
+        d_bottom.store(bottom, std::memory_order_seq_cst);
+        int64_t top = d_top.load(std::memory_order_seq_cst);
+
+        if (top > bottom)
+        {
+            d_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        T* item = array->get(bottom);
+        if (top == bottom)
+        {
+            // Last item, race against thieves for it
+            if (!d_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                item = nullptr;
+            d_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        return item;
+    }
+
+    // Any thread
+    T* steal()
+    {
+        int64_t top = d_top.load(std::memory_order_seq_cst);
+        int64_t bottom = d_bottom.load(std::memory_order_seq_cst);
+
+        if (top >= bottom)
+            return nullptr;
+
+        Array* array = d_array.load(std::memory_order_acquire);
+        T* item = array->get(top);
+
+        if (!d_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+
+        return item;
+    }
+
+    size_t size() const
+    {
+        int64_t bottom = d_bottom.load(std::memory_order_relaxed);
+        int64_t top = d_top.load(std::memory_order_relaxed);
+        return bottom > top ? static_cast<size_t>(bottom - top) : 0;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+private:
+    struct Array
+    {
+        explicit Array(int64_t size) : capacity(size), mask(size - 1), items(new std::atomic<T*>[size]) {}
+
+        ~Array()
+        {
+            delete[] items;
+        }
+
+        T* get(int64_t index) const
+        {
+            return items[index & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(int64_t index, T* item)
+        {
+            items[index & mask].store(item, std::memory_order_relaxed);
+        }
+
+        Array* grow(int64_t bottom, int64_t top) const
+        {
+            auto array = new Array(capacity * 2);
+            for (int64_t index = top; index != bottom; ++index)
+                array->put(index, get(index));
+            return array;
+        }
+
+        const int64_t capacity;
+        const int64_t mask;
+        std::atomic<T*>* items;
+    };
+
+    alignas(64) std::atomic<int64_t> d_top { 0 };
+    alignas(64) std::atomic<int64_t> d_bottom { 0 };
+    std::atomic<Array*> d_array;
+    std::vector<Array*> d_retired;
+};